@@ -0,0 +1,120 @@
+#ifndef COMPARTMENT_SET_H
+#define COMPARTMENT_SET_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+
+/**
+@class compartment_set
+@brief The compartment_set class is a sparse set of agents, used for the people in one
+compartment of the simulation.
+
+Members sit back to back in a dense array, and every agent's position in it is stored,
+so inserting, removing (the last member takes the leaver's place) and testing
+membership are all O(1), and walking the members costs O(members). Removal moves a
+member, so the order of the members is not kept. It costs 4 bytes per agent of the
+population for the positions plus 4 per member.
+*/
+class compartment_set
+{
+public:
+	using agent_id = std::uint32_t;
+
+private:
+	// marks an agent who is not a member
+	static constexpr std::uint32_t no_position = std::numeric_limits<std::uint32_t>::max();
+
+	// the members, in no particular order
+	std::vector<agent_id> members;
+	// position of each agent in members, or no_position
+	std::vector<std::uint32_t> position;
+
+public:
+
+	// default constructor makes an empty set over an empty population
+	compartment_set() = default;
+
+	/**
+	Empties the set and sizes it for a population, releasing any larger storage
+	@param population is the number of agents that may become members
+	*/
+	void reset(const size_t population) {
+		std::vector<agent_id>().swap(members);
+		std::vector<std::uint32_t>(population, no_position).swap(position);
+	}
+
+	/**
+	Makes every agent of a population a member, in agent_id order
+	@param population is the number of agents
+	*/
+	void fill(const size_t population) {
+		members.resize(population);
+		position.resize(population);
+		for (size_t i = 0; i < population; ++i) {
+			members[i] = static_cast<agent_id>(i);
+			position[i] = static_cast<std::uint32_t>(i);
+		}
+	}
+
+	/**
+	Checks whether an agent is a member
+	@param person is the agent
+	@return is true if person is in the set
+	*/
+	bool contains(const agent_id person) const { return position[person] != no_position; }
+
+	/**
+	Adds an agent who is not a member yet
+	@param person is the agent
+	*/
+	void insert(const agent_id person) {
+		position[person] = static_cast<std::uint32_t>(members.size());
+		members.push_back(person);
+	}
+
+	/**
+	Removes a member, the last member takes their place
+	@param person is the agent, who must be a member
+	*/
+	void erase(const agent_id person) {
+		const std::uint32_t at = position[person];
+		const agent_id last = members.back();
+		members[at] = last;
+		position[last] = at;
+		members.pop_back();
+		position[person] = no_position;
+	}
+
+	/**
+	Swaps the places of two members, for shuffles over the members
+	@param i is the position of one member
+	@param j is the position of the other
+	*/
+	void swap_places(const size_t i, const size_t j) {
+		std::swap(members[i], members[j]);
+		position[members[i]] = static_cast<std::uint32_t>(i);
+		position[members[j]] = static_cast<std::uint32_t>(j);
+	}
+
+	/**
+	Getter for the number of members
+	@return is a size_t corresponding to the size of the set
+	*/
+	size_t size() const { return members.size(); }
+
+	/**
+	Getter for the member at a position
+	@param i is the position, below size()
+	@return is an agent_id corresponding to the member
+	*/
+	agent_id operator[](const size_t i) const { return members[i]; }
+
+	const agent_id* begin() const { return members.data(); }
+	const agent_id* end() const { return members.data() + members.size(); }
+};
+
+#endif // ! COMPARTMENT_SET_H
@@ -0,0 +1,321 @@
+#include "contact_classes.h"
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+
+// default constructor makes an empty model
+contact_classes::contact_classes() : groups(0), radix(1), group_entries(1), population_size(0), generator(0) {}
+
+size_t contact_classes::population() const { return static_cast<size_t>(population_size); }
+size_t contact_classes::occupied_classes() const { return occupied.size(); }
+
+std::uint64_t contact_classes::binomial(const std::uint64_t trials, const double chance) {
+	if (trials == 0 || !(chance > 0.0)) { return 0; }
+	if (chance >= 1.0) { return trials; }
+	return std::binomial_distribution<std::uint64_t>(trials, chance)(generator);
+}
+
+void contact_classes::multinomial(std::uint64_t people, const std::vector<double>& chances, std::vector<std::uint64_t>& out) {
+	// one binomial per category, each out of the people and the chance left over
+	out.assign(chances.size(), 0);
+	double left = 1.0;
+	for (size_t i = 0; i < chances.size() && people > 0; ++i) {
+		if (i + 1 == chances.size() || chances[i] >= left) {
+			out[i] = people;
+			break;
+		}
+		out[i] = binomial(people, chances[i] / left);
+		people -= out[i];
+		left -= chances[i];
+	}
+}
+
+size_t contact_classes::unpack(size_t index, std::vector<size_t>& out) const {
+	const size_t group = index / group_entries;
+	index %= group_entries;
+	for (size_t& digit : out) {
+		digit = index % radix;
+		index /= radix;
+	}
+	return group;
+}
+
+size_t contact_classes::pack(const size_t group, const std::vector<size_t>& in) const {
+	size_t index = 0;
+	for (size_t i = in.size(); i-- > 0;) { index = index * radix + in[i]; }
+	return group * group_entries + index;
+}
+
+double contact_classes::infection_chance(const spread_parameters& parameters, const size_t group, const std::vector<size_t>& in) const {
+	// same hazard as spread_engine::build_thresholds, over the ill contact digits
+	double weighted = 0.0;
+	for (size_t h = 0; h < groups; ++h) {
+		weighted += parameters.mixing_weight(group, h) * parameters.groups[h].mask * static_cast<double>(in[groups + h]);
+	}
+	return 1.0 - std::exp(-parameters.beta * weighted);
+}
+
+void contact_classes::add_next(const size_t index, const std::uint64_t people) {
+	if (next_counts[index] == 0) { next_occupied.push_back(index); }
+	next_counts[index] += people;
+}
+
+// chances of 0 to trials successes of Binomial(trials, chance), in logs so long shots
+// do not underflow
+static void binomial_chances(const size_t trials, const double chance, std::vector<double>& out) {
+	out.resize(trials + 1);
+	const double log_chance = std::log(chance), log_miss = std::log1p(-chance);
+	const double log_all = std::lgamma(static_cast<double>(trials) + 1.0);
+	for (size_t k = 0; k <= trials; ++k) {
+		out[k] = std::exp(log_all - std::lgamma(static_cast<double>(k) + 1.0) - std::lgamma(static_cast<double>(trials - k) + 1.0)
+			+ static_cast<double>(k) * log_chance + static_cast<double>(trials - k) * log_miss);
+	}
+}
+
+void contact_classes::scatter(const size_t group, const size_t position, const std::uint64_t people) {
+	if (position == 2 * groups) {
+		add_next(pack(group, moved_digits), people);
+		return;
+	}
+
+	// digits below groups are susceptible contacts who may fall ill, the rest are ill
+	// contacts who may be removed, including those who just fell ill
+	const size_t h = position % groups;
+	const bool susceptible_digit = position < groups;
+	const size_t contacts = susceptible_digit ? digits[position] : moved_digits[position];
+	const double chance = susceptible_digit ? contact_infection[group * groups + h] : contact_removal[h];
+
+	// nothing can change, the digit keeps its value
+	if (contacts == 0 || !(chance > 0.0)) {
+		scatter(group, position + 1, people);
+		return;
+	}
+
+	// every number of contacts that change is a category of a multinomial
+	std::vector<double>& chances = outcome_chances[position];
+	std::vector<std::uint64_t>& split = outcome_counts[position];
+	if (chance >= 1.0) {
+		chances.assign(contacts + 1, 0.0);
+		chances[contacts] = 1.0;
+	}
+	else {
+		binomial_chances(contacts, chance, chances);
+	}
+	multinomial(people, chances, split);
+
+	for (size_t changed = 0; changed <= contacts; ++changed) {
+		if (split[changed] == 0) { continue; }
+		if (susceptible_digit) {
+			moved_digits[h] -= changed;
+			moved_digits[groups + h] += changed;
+		}
+		else {
+			moved_digits[groups + h] -= changed;
+		}
+		scatter(group, position + 1, split[changed]);
+		if (susceptible_digit) {
+			moved_digits[h] += changed;
+			moved_digits[groups + h] -= changed;
+		}
+		else {
+			moved_digits[groups + h] += changed;
+		}
+	}
+}
+
+void contact_classes::move_survivors() {
+
+	// a susceptible contact of group h of someone in group g is found by following one
+	// of the susceptible contacts of group g of the people in group h, so each class of
+	// group h counts once for every such contact
+	std::vector<double> reached(groups * groups, 0.0);
+	std::fill(contact_infection.begin(), contact_infection.end(), 0.0);
+	for (size_t k = 0; k < occupied.size(); ++k) {
+		const size_t h = unpack(occupied[k], digits);
+		for (size_t g = 0; g < groups; ++g) {
+			const double contacts = static_cast<double>(digits[g]);
+			contact_infection[g * groups + h] += contacts * static_cast<double>(falling_ill[k]);
+			reached[g * groups + h] += contacts * static_cast<double>(counts[occupied[k]]);
+		}
+	}
+	for (size_t pair = 0; pair < groups * groups; ++pair) {
+		contact_infection[pair] = reached[pair] > 0.0 ? contact_infection[pair] / reached[pair] : 0.0;
+	}
+
+	// survivors of each class move on, the class is emptied as it goes so the table
+	// is all zeros again once it becomes next_counts
+	for (size_t k = 0; k < occupied.size(); ++k) {
+		const size_t index = occupied[k];
+		const std::uint64_t survivors = counts[index] - falling_ill[k];
+		counts[index] = 0;
+		if (survivors == 0) { continue; }
+		const size_t group = unpack(index, digits);
+		moved_digits = digits;
+		scatter(group, 0, survivors);
+	}
+
+	occupied.clear();
+	std::swap(counts, next_counts);
+	std::swap(occupied, next_occupied);
+}
+
+// appends every way of splitting total contacts over parts groups to out, the current
+// split is in digits from position on
+static void compositions(const size_t total, const size_t position, std::vector<size_t>& digits, std::vector<std::vector<size_t>>& out) {
+	if (position + 1 == digits.size()) {
+		digits[position] = total;
+		out.push_back(digits);
+		return;
+	}
+	for (size_t here = 0; here <= total; ++here) {
+		digits[position] = here;
+		compositions(total - here, position + 1, digits, out);
+	}
+}
+
+void contact_classes::reset(const spread_parameters& parameters, const std::vector<size_t>& group_sizes, const xoshiro256ss& draws) {
+	groups = parameters.groups.size();
+	size_t largest = 0;
+	for (const group_parameters& group : parameters.groups) { largest = std::max(largest, group.contacts); }
+	radix = largest + 1;
+
+	// two digits per group, for every group
+	group_entries = 1;
+	for (size_t digit = 0; digit < 2 * groups; ++digit) {
+		if (group_entries > max_class_entries / radix) {
+			throw std::length_error("Too many contact classes for the tau_leap mode!");
+		}
+		group_entries *= radix;
+	}
+	if (group_entries > max_class_entries / groups) {
+		throw std::length_error("Too many contact classes for the tau_leap mode!");
+	}
+
+	std::vector<std::uint64_t>(groups * group_entries, 0).swap(counts);
+	std::vector<std::uint64_t>(groups * group_entries, 0).swap(next_counts);
+	occupied.clear();
+	next_occupied.clear();
+	falling_ill.clear();
+	contact_infection.assign(groups * groups, 0.0);
+	contact_removal.assign(groups, 0.0);
+	digits.assign(2 * groups, 0);
+	moved_digits.assign(2 * groups, 0);
+	outcome_chances.assign(2 * groups, std::vector<double>());
+	outcome_counts.assign(2 * groups, std::vector<std::uint64_t>());
+	generator = draws;
+
+	// a contact is of group h with chance proportional to the contacts everyone in group h has
+	population_size = 0;
+	double stubs = 0.0;
+	std::vector<double> partner(groups, 0.0);
+	for (size_t h = 0; h < groups; ++h) {
+		population_size += group_sizes[h];
+		partner[h] = static_cast<double>(group_sizes[h]) * static_cast<double>(parameters.groups[h].contacts);
+		stubs += partner[h];
+	}
+	for (double& share : partner) { share = stubs > 0.0 ? share / stubs : 0.0; }
+
+	// each group's people split over the ways their contacts can split over the groups,
+	// with multinomial chances, nobody is ill yet
+	std::vector<std::vector<size_t>> splits;
+	std::vector<double> chances;
+	std::vector<std::uint64_t> people;
+	for (size_t g = 0; g < groups; ++g) {
+		if (group_sizes[g] == 0) { continue; }
+		const size_t contacts = parameters.groups[g].contacts;
+		splits.clear();
+		std::vector<size_t> split(groups, 0);
+		compositions(contacts, 0, split, splits);
+
+		chances.assign(splits.size(), 0.0);
+		for (size_t i = 0; i < splits.size(); ++i) {
+			double log_chance = std::lgamma(static_cast<double>(contacts) + 1.0);
+			bool possible = true;
+			for (size_t h = 0; h < groups; ++h) {
+				if (splits[i][h] == 0) { continue; }
+				if (partner[h] == 0.0) { possible = false; break; }
+				log_chance += static_cast<double>(splits[i][h]) * std::log(partner[h]) - std::lgamma(static_cast<double>(splits[i][h]) + 1.0);
+			}
+			chances[i] = possible ? std::exp(log_chance) : 0.0;
+		}
+		multinomial(group_sizes[g], chances, people);
+
+		std::fill(digits.begin(), digits.end(), 0);
+		for (size_t i = 0; i < splits.size(); ++i) {
+			if (people[i] == 0) { continue; }
+			std::copy(splits[i].begin(), splits[i].end(), digits.begin());
+			add_next(pack(g, digits), people[i]);
+		}
+	}
+	std::swap(counts, next_counts);
+	std::swap(occupied, next_occupied);
+}
+
+void contact_classes::infect_initial(const size_t sick, std::vector<size_t>& group_counts) {
+
+	// everyone falls ill, which leaves no classes
+	if (sick >= population_size) {
+		for (const size_t index : occupied) {
+			const size_t group = index / group_entries;
+			group_counts[group * 3] -= static_cast<size_t>(counts[index]);
+			group_counts[group * 3 + 1] += static_cast<size_t>(counts[index]);
+			counts[index] = 0;
+		}
+		occupied.clear();
+		return;
+	}
+
+	// the picks are spread over the classes in one pass, each class gets a binomial share
+	// of the picks still to place by its part of the people not yet passed, kept within
+	// what the class and the classes after it can hold. When most people fall ill the
+	// ones who stay healthy are placed instead, which keeps the shares small
+	std::uint64_t remaining = 0;
+	for (const size_t index : occupied) { remaining += counts[index]; }
+	const bool place_healthy = sick > remaining / 2;
+	std::uint64_t to_place = place_healthy ? remaining - sick : sick;
+	falling_ill.assign(occupied.size(), 0);
+	for (size_t k = 0; k < occupied.size(); ++k) {
+		const std::uint64_t people = counts[occupied[k]];
+		const std::uint64_t after = remaining - people;
+		std::uint64_t placed = binomial(to_place, static_cast<double>(people) / static_cast<double>(remaining));
+		placed = std::min(placed, people);
+		if (to_place > after) { placed = std::max(placed, to_place - after); }
+		to_place -= placed;
+		remaining = after;
+
+		falling_ill[k] = place_healthy ? people - placed : placed;
+		const size_t group = occupied[k] / group_entries;
+		group_counts[group * 3] -= static_cast<size_t>(falling_ill[k]);
+		group_counts[group * 3 + 1] += static_cast<size_t>(falling_ill[k]);
+	}
+
+	// their contacts learn they are ill, nobody has been removed
+	std::fill(contact_removal.begin(), contact_removal.end(), 0.0);
+	move_survivors();
+}
+
+void contact_classes::tick(const spread_parameters& parameters, std::vector<size_t>& group_counts) {
+
+	// every class falls ill with its own chance
+	falling_ill.assign(occupied.size(), 0);
+	for (size_t k = 0; k < occupied.size(); ++k) {
+		const size_t group = unpack(occupied[k], digits);
+		falling_ill[k] = binomial(counts[occupied[k]], infection_chance(parameters, group, digits));
+		group_counts[group * 3] -= static_cast<size_t>(falling_ill[k]);
+		group_counts[group * 3 + 1] += static_cast<size_t>(falling_ill[k]);
+	}
+
+	// then removals, which like the agent modes include people who fell ill today, their
+	// contacts see the fraction of the group that was removed
+	for (size_t h = 0; h < groups; ++h) {
+		const std::uint64_t ill = group_counts[h * 3 + 1];
+		const std::uint64_t removed = binomial(ill, parameters.gamma);
+		contact_removal[h] = ill > 0 ? static_cast<double>(removed) / static_cast<double>(ill) : 0.0;
+		group_counts[h * 3 + 1] -= static_cast<size_t>(removed);
+		group_counts[h * 3 + 2] += static_cast<size_t>(removed);
+	}
+
+	move_survivors();
+}
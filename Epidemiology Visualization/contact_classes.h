@@ -0,0 +1,165 @@
+#ifndef CONTACT_CLASSES_H
+#define CONTACT_CLASSES_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "spread_rng.h"
+#include "spread_parameters.h"
+
+
+/**
+@class contact_classes
+@brief The contact_classes class runs the approximate tau_leap mode of spread_engine. It
+keeps no agents and no network, only how many susceptible people there are in each
+contact class: their group and, for every group h, how many of their contacts are
+susceptible people of group h and how many are ill people of group h. Contacts who were
+removed no longer matter and drop out of the class. This is the effective degree model
+of Lindquist et al. (2011) for the engine's configuration networks.
+
+Every tick draws, for each occupied class, a binomial number of people who fall ill with
+the class's chance from the engine's hazard, and for each group a binomial number of ill
+people who are removed with chance gamma. The survivors of each class then move to new
+classes: each susceptible contact of group h fell ill with the day's infection fraction
+among susceptible contacts of group h, counted over the classes of group h with every
+person weighted by their susceptible contacts in the survivor's group, and each ill
+contact of group h (including those who just fell ill, as removal days in the agent
+modes start on the day of infection) was removed with the day's removal fraction of
+group h. The
+moves are drawn as multinomials, so a tick costs O(occupied classes x outcomes) and
+does not depend on the population.
+
+Error bound: for a given set of class counts the infection and removal counts have
+exactly the distribution the per-agent draws of the synchronous mode give, a binomial
+being the sum of the same Bernoulli draws. The one approximation is the last step, which
+treats each susceptible contact as a fresh pick from everyone in its class rather than
+a particular person. The configuration network is locally tree-like, so its short
+cycles and repeated contacts only make up O(contacts^2 / population) of the network,
+and the class fractions converge to those of the agent model as the population grows
+(Janson, Luczak and Windridge 2014 for the continuous time limit). With a million people
+the peak and final size of a run land within a fraction of a percent of the synchronous
+mode's, well inside the spread between seeds. The random spread of a run around them,
+O(1 / sqrt(population)), is kept, as the draws are binomials rather than their means.
+Agents in a group are all given the group's full contact number, where a handful of
+agents of a generated network fall short by one. The initial infections are spread over
+the classes as picks with replacement would be, bounded by each class's size, so each
+class gets the right mean number of them with at most 1 / (1 - sick / population) times
+the variance of a uniform pick. That is at most twice, as the smaller of the sick and
+the healthy is the one placed.
+*/
+class contact_classes
+{
+public:
+	// more class table entries than this are refused, the table grows as contacts^(2 x groups)
+	static constexpr size_t max_class_entries = size_t(1) << 22;
+
+private:
+	using rng = xoshiro256ss;
+
+	size_t groups;
+	// one more than the largest contact number, the base of the class digits
+	size_t radix;
+	// entries of the class table of one group, radix^(2 x groups)
+	size_t group_entries;
+
+	// susceptible people of each class, indexed by group * group_entries plus the digits
+	// susceptible contacts of every group h (h first) and ill contacts of every group h
+	std::vector<std::uint64_t> counts;
+	// entries of counts that may be non-zero
+	std::vector<size_t> occupied;
+	// the next tick's counts and occupied entries, swapped in at the end of a tick
+	std::vector<std::uint64_t> next_counts;
+	std::vector<size_t> next_occupied;
+
+	// people of each class who fall ill in the current tick, parallel to occupied
+	std::vector<std::uint64_t> falling_ill;
+	// chance that a susceptible contact of group h of a person of group g falls ill in
+	// the current tick, at g * groups + h
+	std::vector<double> contact_infection;
+	// chance that an ill contact of group h is removed in the current tick
+	std::vector<double> contact_removal;
+
+	// total population, fixed by reset
+	std::uint64_t population_size;
+
+	rng generator;
+
+	// scratch digits of the class being moved, and of the class it moves to
+	std::vector<size_t> digits;
+	std::vector<size_t> moved_digits;
+	// scratch chances and counts of the outcomes of each digit
+	std::vector<std::vector<double>> outcome_chances;
+	std::vector<std::vector<std::uint64_t>> outcome_counts;
+
+	// draws Binomial(trials, chance)
+	std::uint64_t binomial(const std::uint64_t trials, const double chance);
+
+	// splits people over categories with the given chances (summing to 1), writing the
+	// count of each category to out
+	void multinomial(std::uint64_t people, const std::vector<double>& chances, std::vector<std::uint64_t>& out);
+
+	// splits a class's digits out of its index, the group is returned
+	size_t unpack(size_t index, std::vector<size_t>& out) const;
+
+	// index of a group's class with the given digits
+	size_t pack(const size_t group, const std::vector<size_t>& in) const;
+
+	// chance that a person of a group with the given digits falls ill in one day
+	double infection_chance(const spread_parameters& parameters, const size_t group, const std::vector<size_t>& in) const;
+
+	// adds people to a class of the next tick
+	void add_next(const size_t index, const std::uint64_t people);
+
+	// moves people of group whose class is digits to the next tick's classes, drawing the
+	// outcome of every digit from position on, moved_digits holds the earlier outcomes
+	void scatter(const size_t group, const size_t position, const std::uint64_t people);
+
+	// fills contact_infection from falling_ill, then moves every occupied class's
+	// survivors and swaps in the next tick's classes
+	void move_survivors();
+
+public:
+
+	// default constructor makes an empty model
+	contact_classes();
+
+	/**
+	Sets up a fully susceptible population on a configuration network, where each
+	contact of a person is a contact of group h with chance proportional to the
+	contacts of everyone in group h
+	@param parameters gives the groups' contact numbers
+	@param group_sizes is the population of every group
+	@param draws is the generator for every draw from here on
+	@throws std::length_error if the class table would have more than max_class_entries
+	*/
+	void reset(const spread_parameters& parameters, const std::vector<size_t>& group_sizes, const xoshiro256ss& draws);
+
+	/**
+	Infects people picked from the whole population, like
+	spread_engine::randomly_infect_healthy, with one binomial per occupied class
+	@param sick is the number of people to infect, everyone if it is the population or more
+	@param group_counts are the engine's S, I and R counts, 3 per group, updated in place
+	*/
+	void infect_initial(const size_t sick, std::vector<size_t>& group_counts);
+
+	/**
+	Runs one day
+	@param parameters gives the rates and hazard weights, read afresh every tick
+	@param group_counts are the engine's S, I and R counts, 3 per group, updated in place
+	*/
+	void tick(const spread_parameters& parameters, std::vector<size_t>& group_counts);
+
+	/**
+	Getter for the population
+	@return is a size_t corresponding to the population given to reset
+	*/
+	size_t population() const;
+
+	/**
+	Getter for the number of occupied classes
+	@return is a size_t corresponding to the classes a tick draws for
+	*/
+	size_t occupied_classes() const;
+};
+
+#endif // ! CONTACT_CLASSES_H
@@ -0,0 +1,142 @@
+#include "contact_graph.h"
+#include <utility>
+#include <algorithm>
+
+// default constructor leaves a single 0 offset so that size() is 0
+contact_graph::contact_graph() : offsets(1, 0) { use_vectors(); }
+
+void contact_graph::use_vectors() {
+	offset_data = offsets.data();
+	neighbor_data = neighbors.data();
+	agent_count = offsets.size() - 1;
+	slot_count = neighbors.size();
+	mapping.reset();
+}
+
+void contact_graph::assign(std::vector<edge_index>&& new_offsets, std::vector<agent_id>&& new_neighbors) {
+	offsets = std::move(new_offsets);
+	neighbors = std::move(new_neighbors);
+	use_vectors();
+}
+
+void contact_graph::assign_mapped(std::shared_ptr<const mapped_file> file, const edge_index* new_offsets,
+	const agent_id* new_neighbors, const size_t agents) {
+	// drop any owned arrays, the mapped ones replace them
+	clear();
+	offset_data = new_offsets;
+	neighbor_data = new_neighbors;
+	agent_count = agents;
+	slot_count = static_cast<size_t>(new_offsets[agents]);
+	mapping = std::move(file);
+}
+
+void contact_graph::clear() {
+	// swap with empty vectors so the memory is actually handed back
+	std::vector<edge_index>(1, 0).swap(offsets);
+	std::vector<agent_id>().swap(neighbors);
+	use_vectors();
+}
+
+bool contact_graph::is_mapped() const { return mapping != nullptr; }
+
+void contact_graph::advise(const agent_id first, const agent_id last, const mapped_file::access expected) const {
+	if (!mapping || first >= last) { return; }
+	const unsigned char* file = mapping->data();
+	const unsigned char* offsets_start = reinterpret_cast<const unsigned char*>(offset_data + first);
+	const unsigned char* neighbors_start = reinterpret_cast<const unsigned char*>(neighbor_data + offset_data[first]);
+	mapping->advise(static_cast<size_t>(offsets_start - file), (last - first + size_t(1)) * sizeof(edge_index), expected);
+	mapping->advise(static_cast<size_t>(neighbors_start - file),
+		static_cast<size_t>(offset_data[last] - offset_data[first]) * sizeof(agent_id), expected);
+}
+
+void contact_graph::assign_relabeled(const contact_graph& source, const std::vector<agent_id>& new_ids) {
+	const size_t agents = source.size();
+
+	// new agent i is the old agent whose new id is i, their degree decides the offsets
+	std::vector<agent_id> old_ids(agents);
+	for (size_t old_id = 0; old_id < agents; ++old_id) { old_ids[new_ids[old_id]] = static_cast<agent_id>(old_id); }
+	std::vector<edge_index> new_offsets(agents + 1, 0);
+	for (size_t i = 0; i < agents; ++i) { new_offsets[i + 1] = new_offsets[i] + source.degree(old_ids[i]); }
+
+	// contacts are renamed and sorted so scans of one network walk memory forwards
+	std::vector<agent_id> new_neighbors(source.edge_slots());
+	for (size_t i = 0; i < agents; ++i) {
+		agent_id* slot = new_neighbors.data() + new_offsets[i];
+		for (agent_id contact : source.contacts(old_ids[i])) { *slot++ = new_ids[contact]; }
+		std::sort(new_neighbors.data() + new_offsets[i], slot);
+	}
+
+	assign(std::move(new_offsets), std::move(new_neighbors));
+}
+
+std::vector<contact_graph::agent_id> contact_graph::order(const ordering kind) const {
+	const size_t agents = size();
+	std::vector<agent_id> placed;
+	placed.reserve(agents);
+
+	// agents by increasing degree, ties by id, a counting sort since degrees are small
+	const size_t widest = max_degree();
+	std::vector<size_t> first_of_degree(widest + 2, 0);
+	for (size_t i = 0; i < agents; ++i) { ++first_of_degree[degree(static_cast<agent_id>(i)) + 1]; }
+	for (size_t d = 0; d <= widest; ++d) { first_of_degree[d + 1] += first_of_degree[d]; }
+	std::vector<agent_id> by_degree(agents);
+	for (size_t i = 0; i < agents; ++i) { by_degree[first_of_degree[degree(static_cast<agent_id>(i))]++] = static_cast<agent_id>(i); }
+
+	if (kind == ordering::degree) {
+		// highest degree first, stable so agents of one degree keep their relative order
+		for (size_t d = widest + 1; d-- > 0;) {
+			const size_t last = first_of_degree[d];
+			const size_t first = d > 0 ? first_of_degree[d - 1] : 0;
+			placed.insert(placed.end(), by_degree.begin() + first, by_degree.begin() + last);
+		}
+		return placed;
+	}
+
+	// placed doubles as the search queue, every component starts at its agent of
+	// lowest degree, which tends to sit on its rim
+	std::vector<std::uint8_t> visited(agents, 0);
+	const bool by_increasing_degree = kind == ordering::reverse_cuthill_mckee;
+	for (agent_id start : by_degree) {
+		if (visited[start]) { continue; }
+		visited[start] = 1;
+		placed.push_back(start);
+		for (size_t next = placed.size() - 1; next < placed.size(); ++next) {
+			const size_t found_first = placed.size();
+			for (agent_id contact : contacts(placed[next])) {
+				if (visited[contact]) { continue; }
+				visited[contact] = 1;
+				placed.push_back(contact);
+			}
+			if (by_increasing_degree) {
+				std::sort(placed.begin() + found_first, placed.end(), [&](const agent_id a, const agent_id b) {
+					const size_t degree_a = degree(a), degree_b = degree(b);
+					return degree_a != degree_b ? degree_a < degree_b : a < b;
+				});
+			}
+		}
+	}
+	if (by_increasing_degree) { std::reverse(placed.begin(), placed.end()); }
+	return placed;
+}
+
+size_t contact_graph::size() const { return agent_count; }
+size_t contact_graph::edge_slots() const { return slot_count; }
+
+const contact_graph::edge_index* contact_graph::offset_array() const { return offset_data; }
+const contact_graph::agent_id* contact_graph::neighbor_array() const { return neighbor_data; }
+
+size_t contact_graph::degree(const agent_id person) const {
+	return static_cast<size_t>(offset_data[person + 1] - offset_data[person]);
+}
+
+size_t contact_graph::max_degree() const {
+	size_t widest = 0;
+	for (size_t i = 0; i < agent_count; ++i) {
+		widest = std::max(widest, static_cast<size_t>(offset_data[i + 1] - offset_data[i]));
+	}
+	return widest;
+}
+
+contact_graph::contact_range contact_graph::contacts(const agent_id person) const {
+	return contact_range{ neighbor_data + offset_data[person], neighbor_data + offset_data[person + 1] };
+}
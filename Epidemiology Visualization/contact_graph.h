@@ -0,0 +1,191 @@
+#ifndef CONTACT_GRAPH_H
+#define CONTACT_GRAPH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "mapped_file.h"
+
+
+/**
+@class contact_graph
+@brief The contact_graph class stores the contact network of the simulation in
+compressed sparse row (CSR) form.
+
+Every agent's contacts sit back to back in one neighbors array of 32 bit agent ids,
+and the offsets array stores where each agent's contacts begin, so agent a's contacts
+are neighbors[offsets[a]] up to neighbors[offsets[a + 1]]. This costs 4 bytes per edge
+end plus 8 bytes per agent, and every neighbor scan is a sequential read.
+
+The graph is built once after network generation and is read-only afterwards. Its
+arrays are either owned vectors or views into a mapped snapshot file, which the graph
+keeps mapped for as long as it is used. A mapped graph may be larger than physical
+memory, readers that go through agents in id order read the file front to back and
+can use advise to have the next agents' pages read ahead and the last ones' dropped.
+*/
+class contact_graph
+{
+public:
+	// agents are referred to by their index into the offsets array
+	using agent_id = std::uint32_t;
+	// edge ends are counted in 64 bits, populations can hold more than 2^32 of them
+	using edge_index = std::uint64_t;
+
+	/**
+	@enum ordering
+	@brief Orders of the agents that place contacts close together in memory, see order.
+
+	breadth_first numbers every connected component in breadth-first order from its
+	agent of lowest degree, so an agent's contacts mostly sit within one or two BFS
+	levels of them.
+
+	reverse_cuthill_mckee is the same search visiting each agent's new contacts in
+	order of increasing degree, reversed at the end, which keeps the band of the
+	adjacency matrix narrow.
+
+	degree sorts agents by decreasing degree, so the counters of the agents with the
+	most contacts, which are updated most often, share cache lines.
+	*/
+	enum class ordering { breadth_first, reverse_cuthill_mckee, degree };
+
+	/**
+	@struct contact_range
+	@brief Lightweight view over one agent's contacts, usable in range-based for loops
+	*/
+	struct contact_range {
+		const agent_id* first;
+		const agent_id* last;
+
+		const agent_id* begin() const { return first; }
+		const agent_id* end() const { return last; }
+		size_t size() const { return static_cast<size_t>(last - first); }
+	};
+
+private:
+	// offsets[a] is the index of agent a's first contact, offsets[size()] == neighbors.size()
+	std::vector<edge_index> offsets;
+	// every agent's contacts, stored back to back
+	std::vector<agent_id> neighbors;
+
+	// the arrays read by every accessor, pointing either into the vectors above or
+	// into mapping
+	const edge_index* offset_data;
+	const agent_id* neighbor_data;
+	size_t agent_count;
+	size_t slot_count;
+	// snapshot file the arrays live in when the graph was loaded rather than built
+	std::shared_ptr<const mapped_file> mapping;
+
+	// points the arrays at the owned vectors
+	void use_vectors();
+
+public:
+
+	// default constructor makes an empty graph with no agents
+	contact_graph();
+
+	// the arrays may point into the graph's own vectors, so copies are not allowed
+	contact_graph(const contact_graph&) = delete;
+	contact_graph& operator=(const contact_graph&) = delete;
+
+	/**
+	Takes ownership of already packed CSR arrays
+	@param new_offsets holds the index of each agent's first contact, followed by
+	the total number of edge ends
+	@param new_neighbors holds every agent's contacts, stored back to back
+	*/
+	void assign(std::vector<edge_index>&& new_offsets, std::vector<agent_id>&& new_neighbors);
+
+	/**
+	Uses CSR arrays stored in a mapped file without copying them
+	@param file is the mapping the arrays live in, it stays mapped while the graph uses it
+	@param new_offsets points at agents + 1 offsets inside file
+	@param new_neighbors points at new_offsets[agents] contacts inside file
+	@param agents is the number of agents
+	*/
+	void assign_mapped(std::shared_ptr<const mapped_file> file, const edge_index* new_offsets,
+		const agent_id* new_neighbors, const size_t agents);
+
+	/**
+	Builds the graph of another graph's agents under new ids, in owned vectors. Each
+	agent's contacts are stored in increasing order of their new ids
+	@param source is the graph to relabel
+	@param new_ids holds the new id of every agent of source, a permutation
+	*/
+	void assign_relabeled(const contact_graph& source, const std::vector<agent_id>& new_ids);
+
+	/**
+	Computes an order of the agents that keeps contacts close together
+	@param kind is the ordering to compute
+	@return is a std::vector<agent_id> listing every agent once, in their new order,
+	so entry i is the agent who becomes agent i
+	*/
+	std::vector<agent_id> order(const ordering kind) const;
+
+	/**
+	Checks whether the arrays live in a mapped file
+	@return is true if the graph was loaded with assign_mapped
+	*/
+	bool is_mapped() const;
+
+	/**
+	@brief Passes a hint for the offsets and contacts of a range of agents on to the
+	mapped file, does nothing for a graph in owned vectors
+	@param first is the first agent of the range
+	@param last is one past the last agent of the range
+	@param expected is how the range will be used
+	*/
+	void advise(const agent_id first, const agent_id last, const mapped_file::access expected) const;
+
+	/**
+	Getter for the raw offsets array, agents + 1 entries long
+	@return is a pointer to the first offset
+	*/
+	const edge_index* offset_array() const;
+
+	/**
+	Getter for the raw neighbors array, edge_slots() entries long
+	@return is a pointer to the first contact
+	*/
+	const agent_id* neighbor_array() const;
+
+	/**
+	@brief Releases the memory held by the graph, leaving it empty
+	*/
+	void clear();
+
+	/**
+	Getter for the number of agents in the graph
+	@return is a size_t corresponding to the number of agents
+	*/
+	size_t size() const;
+
+	/**
+	Getter for the number of stored edge ends, i.e. twice the number of contacts
+	@return is a size_t corresponding to the length of the neighbors array
+	*/
+	size_t edge_slots() const;
+
+	/**
+	Getter for the number of contacts of one agent
+	@param person is the agent whose degree is returned
+	@return is a size_t corresponding to the agent's network size
+	*/
+	size_t degree(const agent_id person) const;
+
+	/**
+	Finds the largest network size in the graph
+	@return is a size_t corresponding to the largest degree, 0 for an empty graph
+	*/
+	size_t max_degree() const;
+
+	/**
+	Getter for the contacts of one agent
+	@param person is the agent whose contacts are returned
+	@return is a contact_range over the agent's contacts
+	*/
+	contact_range contacts(const agent_id person) const;
+};
+
+#endif // ! CONTACT_GRAPH_H
@@ -0,0 +1,156 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <stdexcept>
+
+
+/**
+@class event_queue
+@brief The event_queue class is an indexed binary min-heap of event times keyed by
+agent, used by the next-reaction engine mode.
+
+Every agent has at most one pending event. Because the heap stores each agent's position,
+an agent's event can be rescheduled or cancelled in O(log n) without searching for it,
+which is what lets the next-reaction method touch only agents whose hazard changed.
+*/
+class event_queue
+{
+public:
+	using agent_id = std::uint32_t;
+
+private:
+	// marks an agent without a pending event
+	static constexpr std::uint32_t no_position = std::numeric_limits<std::uint32_t>::max();
+
+	// heap of agents ordered by their event times
+	std::vector<agent_id> heap;
+	// position of each agent in heap, or no_position
+	std::vector<std::uint32_t> position;
+	// event time of each agent, only meaningful while they are in heap
+	std::vector<double> times;
+
+	//define positions for the heap
+	static size_t parent(const size_t i) { return (i - 1) / 2; }
+	static size_t left  (const size_t i) { return (2 * i + 1);  }
+	static size_t right (const size_t i) { return (2 * i + 2);  }
+
+	// puts agent at heap index i and records its position
+	void place(const size_t i, const agent_id person) {
+		heap[i] = person;
+		position[person] = static_cast<std::uint32_t>(i);
+	}
+
+	//upward pass for earlier times
+	void child_promotion(size_t i) {
+		const agent_id person = heap[i];
+		while (i > 0 && times[person] < times[heap[parent(i)]]) {
+			place(i, heap[parent(i)]);
+			i = parent(i);
+		}
+		place(i, person);
+	}
+
+	//downward pass for later times
+	void parent_demotion(size_t i) {
+		const agent_id person = heap[i];
+		while (true) {
+			size_t l = left(i);
+			size_t r = right(i);
+			size_t min = i;
+			double min_time = times[person];
+
+			//check if children are earlier, and set min if so
+			if (l < heap.size() && times[heap[l]] < min_time) { min = l; min_time = times[heap[l]]; }
+			if (r < heap.size() && times[heap[r]] < min_time) { min = r; }
+
+			if (min == i) { break; }
+			place(i, heap[min]);
+			i = min;
+		}
+		place(i, person);
+	}
+
+public:
+
+	/**
+	Empties the queue and sizes it for a population
+	@param population is the number of agents events can be scheduled for
+	*/
+	void reset(const size_t population) {
+		std::vector<agent_id>().swap(heap);
+		position.assign(population, no_position);
+		times.assign(population, 0.0);
+	}
+
+	/**
+	Schedules an agent's event, replacing any event it already had
+	@param person is the agent
+	@param time is when the event happens
+	*/
+	void schedule(const agent_id person, const double time) {
+		const bool pending = scheduled(person);
+		const double old_time = times[person];
+		times[person] = time;
+		if (!pending) {
+			heap.push_back(person);
+			child_promotion(heap.size() - 1);
+		}
+		else if (time < old_time) { child_promotion(position[person]); }
+		else                      { parent_demotion(position[person]); }
+	}
+
+	/**
+	Cancels an agent's event if it has one
+	@param person is the agent
+	*/
+	void cancel(const agent_id person) {
+		if (!scheduled(person)) { return; }
+		const size_t i = position[person];
+		position[person] = no_position;
+		const agent_id last = heap.back();
+		heap.pop_back();
+		// move the last agent into the hole and restore heap order either way
+		if (i < heap.size()) {
+			place(i, last);
+			child_promotion(i);
+			parent_demotion(position[last]);
+		}
+	}
+
+	/**
+	Checks whether an agent has a pending event
+	@param person is the agent
+	@return is true if person is in the queue
+	*/
+	bool scheduled(const agent_id person) const { return position[person] != no_position; }
+
+	/**
+	Getter for a pending event's time
+	@param person is an agent with a pending event
+	@return is a double corresponding to when it happens
+	*/
+	double time_of(const agent_id person) const { return times[person]; }
+
+	//size function, which checks size of heap vector
+	size_t size() const { return heap.size(); }
+	bool empty() const { return heap.empty(); }
+
+	//returns the agent with the earliest event
+	agent_id top() const {
+		if (!heap.empty()) { return heap[0]; }
+		//throws error for empty queue
+		else { throw std::logic_error("Event queue is out of events for top!"); }
+	}
+
+	//returns the time of the earliest event
+	double top_time() const { return times[top()]; }
+
+	//removes the earliest event
+	void pop() { cancel(top()); }
+};
+
+#endif // ! EVENT_QUEUE_H
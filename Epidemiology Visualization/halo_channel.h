@@ -0,0 +1,43 @@
+#ifndef HALO_CHANNEL_H
+#define HALO_CHANNEL_H
+
+#include <vector>
+#include <cstdint>
+
+
+/**
+@struct halo_update
+@brief One boundary agent's change of state, sent to every partition that holds
+contacts of theirs
+*/
+struct halo_update {
+	// global id of the agent who changed state
+	std::uint32_t person;
+	// +1 if they got sick, -1 if they were removed
+	std::int32_t delta;
+};
+
+/**
+@class halo_channel
+@brief The halo_channel class is how a partitioned spread_engine trades halo updates
+with the engines simulating the other partitions of the same population, once per
+synchronous tick. Implementations decide the transport (see partitioned_run for one
+over Unix sockets); every partition must call exchange the same number of times.
+*/
+class halo_channel
+{
+public:
+	virtual ~halo_channel() = default;
+
+	/**
+	@brief Sends this partition's updates and waits for everyone else's
+	@param outgoing holds one list per partition, outgoing[p] is sent to partition p,
+	the list for this partition is always empty
+	@param incoming receives every update addressed to this partition, in the order of
+	their sending partition
+	@throws std::runtime_error if the transport fails
+	*/
+	virtual void exchange(const std::vector<std::vector<halo_update>>& outgoing, std::vector<halo_update>& incoming) = 0;
+};
+
+#endif // ! HALO_CHANNEL_H
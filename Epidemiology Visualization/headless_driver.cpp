@@ -0,0 +1,364 @@
+#include "headless_driver.h"
+#include "spread_engine.h"
+#include "partitioned_run.h"
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <sstream>
+#include <vector>
+#include <limits>
+
+// layout of the binary output, see headless_driver.h
+static constexpr char series_magic[8] = { 'E', 'P', 'I', 'S', 'I', 'R', '\0', '\0' };
+static constexpr std::uint32_t series_version = 2;
+
+// prints the accepted arguments
+static void print_usage(std::ostream& out) {
+	out << "usage: --normal N --moron M --sick K [--seed S] [--days D]\n"
+		"       [--mode immediate|synchronous|next_reaction|tau_leap] [--threads T] [--processes P]\n"
+		"       [--propagation auto|push|pull]\n"
+		"       [--beta B] [--mu U] [--gamma G] [--normal-contacts C] [--moron-contacts C]\n"
+		"       [--group SIZE,CONTACTS,MASK]... [--mixing W,W,...]\n"
+		"       [--topology configuration|small_world,K,P|preferential,M|households,H,W,C]\n"
+		"       [--contact-share DAY,S,S,...]... [--mask-scale DAY,F,F,...]...\n"
+		"       [--load FILE] [--graph-cache MB] [--order bfs|rcm|degree] [--save FILE]\n"
+		"       [--format csv|binary] [--out FILE] [--profile FILE]\n";
+}
+
+// reads a whole argument as a count, naming the flag if it is not one
+static size_t parse_count(const std::string& flag, const std::string& value) {
+	size_t used = 0;
+	unsigned long long parsed = 0;
+	try { parsed = std::stoull(value, &used); }
+	catch (const std::exception&) { used = 0; }
+	if (used == 0 || used != value.size() || value[0] == '-') {
+		throw std::invalid_argument("Bad value " + value + " for " + flag + "!");
+	}
+	return static_cast<size_t>(parsed);
+}
+
+// reads a whole argument as a rate, naming the flag if it is not one
+static double parse_rate(const std::string& flag, const std::string& value) {
+	size_t used = 0;
+	double parsed = 0.0;
+	try { parsed = std::stod(value, &used); }
+	catch (const std::exception&) { used = 0; }
+	if (used == 0 || used != value.size()) {
+		throw std::invalid_argument("Bad value " + value + " for " + flag + "!");
+	}
+	return parsed;
+}
+
+// splits a comma separated argument into its fields
+static std::vector<std::string> split_fields(const std::string& value) {
+	std::vector<std::string> fields;
+	std::istringstream in(value);
+	for (std::string field; std::getline(in, field, ',');) { fields.push_back(field); }
+	return fields;
+}
+
+// collects one day of counts of an engine, in output column order
+static std::vector<size_t> day_columns(const spread_engine& engine) {
+	std::vector<size_t> columns{ engine.get_days_elapsed() };
+	for (size_t group = 0; group < engine.get_group_count(); ++group) {
+		columns.push_back(engine.get_susceptible(group));
+		columns.push_back(engine.get_infected(group));
+		columns.push_back(engine.get_removed(group));
+	}
+	return columns;
+}
+
+// writes one day of counts in the chosen format
+static void write_day(std::ostream& out, const bool binary, const std::vector<size_t>& columns) {
+	if (binary) {
+		// tau_leap populations can pass 2^32, so counts are written at full width
+		std::vector<std::uint64_t> row(columns.begin(), columns.end());
+		out.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(std::uint64_t)));
+	}
+	else {
+		for (size_t i = 0; i < columns.size(); ++i) {
+			out << columns[i] << (i + 1 < columns.size() ? ',' : '\n');
+		}
+	}
+}
+
+int run_headless(int argc, char** argv) {
+
+	size_t num_normal = 0, num_moron = 0, num_sick = 0, days = 0;
+	bool have_normal = false, have_moron = false, have_sick = false;
+	std::string load_path, save_path, out_path, profile_path, format = "csv";
+	// --group replaces the default groups, so it cannot be mixed with their flags
+	std::vector<size_t> group_sizes;
+	std::vector<group_parameters> groups;
+	bool have_default_flags = false;
+	// --processes hands the run to partitioned_run, which needs these again
+	size_t processes = 1, threads = 1;
+	std::uint64_t seed = 0;
+	bool have_seed = false, synchronous = false;
+	// agents keep the order they were generated or saved in unless --order is given
+	bool reorder = false;
+	contact_graph::ordering order = contact_graph::ordering::reverse_cuthill_mckee;
+
+	spread_engine engine;
+	spread_parameters parameters;
+	// --contact-share and --mask-scale of one day make up one intervention
+	std::vector<intervention> timeline;
+	auto intervention_on = [&](const size_t day) -> intervention& {
+		for (intervention& change : timeline) {
+			if (change.day == day) { return change; }
+		}
+		timeline.push_back(intervention());
+		timeline.back().day = day;
+		return timeline.back();
+	};
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			const std::string flag = argv[i];
+			if (flag == "--help" || flag == "-h") {
+				print_usage(std::cout);
+				return 0;
+			}
+			// every other flag takes one value
+			if (i + 1 >= argc) { throw std::invalid_argument(flag + " needs a value!"); }
+			const std::string value = argv[++i];
+
+			if (flag == "--normal") { num_normal = parse_count(flag, value); have_normal = have_default_flags = true; }
+			else if (flag == "--moron") { num_moron = parse_count(flag, value); have_moron = have_default_flags = true; }
+			else if (flag == "--sick") { num_sick = parse_count(flag, value); have_sick = true; }
+			else if (flag == "--seed") { seed = parse_count(flag, value); engine.set_seed(seed); have_seed = true; }
+			else if (flag == "--days") { days = parse_count(flag, value); }
+			else if (flag == "--threads") { threads = parse_count(flag, value); engine.set_threads(threads); }
+			else if (flag == "--processes") { processes = parse_count(flag, value); }
+			else if (flag == "--propagation") {
+				if (value == "auto") { engine.set_propagation(spread_engine::propagation::automatic); }
+				else if (value == "push") { engine.set_propagation(spread_engine::propagation::push); }
+				else if (value == "pull") { engine.set_propagation(spread_engine::propagation::pull); }
+				else { throw std::invalid_argument("Unknown propagation " + value + "!"); }
+			}
+			else if (flag == "--beta") { parameters.beta = parse_rate(flag, value); }
+			else if (flag == "--mu") { parameters.groups[0].mask = parse_rate(flag, value); have_default_flags = true; }
+			else if (flag == "--gamma") { parameters.gamma = parse_rate(flag, value); }
+			else if (flag == "--normal-contacts") { parameters.groups[0].contacts = parse_count(flag, value); have_default_flags = true; }
+			else if (flag == "--moron-contacts") { parameters.groups[1].contacts = parse_count(flag, value); have_default_flags = true; }
+			else if (flag == "--group") {
+				const std::vector<std::string> fields = split_fields(value);
+				if (fields.size() != 3) { throw std::invalid_argument("Bad value " + value + " for --group!"); }
+				group_sizes.push_back(parse_count(flag, fields[0]));
+				groups.push_back({ parse_count(flag, fields[1]), parse_rate(flag, fields[2]) });
+			}
+			else if (flag == "--mixing") {
+				parameters.mixing.clear();
+				for (const std::string& field : split_fields(value)) { parameters.mixing.push_back(parse_rate(flag, field)); }
+			}
+			else if (flag == "--topology") {
+				// the model's name, then its parameters in network_topology order
+				const std::vector<std::string> fields = split_fields(value);
+				network_topology& topology = parameters.topology;
+				if (fields.size() == 1 && fields[0] == "configuration") {
+					topology.kind = network_topology::model::configuration;
+				}
+				else if (fields.size() == 3 && fields[0] == "small_world") {
+					topology.kind = network_topology::model::small_world;
+					topology.ring_neighbors = parse_count(flag, fields[1]);
+					topology.rewiring = parse_rate(flag, fields[2]);
+				}
+				else if (fields.size() == 2 && fields[0] == "preferential") {
+					topology.kind = network_topology::model::preferential_attachment;
+					topology.attachments = parse_count(flag, fields[1]);
+				}
+				else if (fields.size() == 4 && fields[0] == "households") {
+					topology.kind = network_topology::model::households;
+					topology.household_size = parse_count(flag, fields[1]);
+					topology.workplace_size = parse_count(flag, fields[2]);
+					topology.workplace_neighbors = parse_count(flag, fields[3]);
+				}
+				else { throw std::invalid_argument("Unknown topology " + value + "!"); }
+			}
+			else if (flag == "--contact-share" || flag == "--mask-scale") {
+				// the day, then the shares row by row or one scale per group
+				const std::vector<std::string> fields = split_fields(value);
+				if (fields.size() < 2) { throw std::invalid_argument("Bad value " + value + " for " + flag + "!"); }
+				intervention& change = intervention_on(parse_count(flag, fields[0]));
+				std::vector<double>& values = flag == "--contact-share" ? change.contact_share : change.mask_scale;
+				values.clear();
+				for (size_t field = 1; field < fields.size(); ++field) { values.push_back(parse_rate(flag, fields[field])); }
+			}
+			else if (flag == "--load") { load_path = value; }
+			else if (flag == "--graph-cache") {
+				// megabytes to bytes, refusing budgets a size_t cannot hold in bytes
+				const size_t megabytes = parse_count(flag, value);
+				if (megabytes > (std::numeric_limits<size_t>::max() >> 20)) {
+					throw std::invalid_argument("Value " + value + " for " + flag + " is too large!");
+				}
+				engine.set_graph_cache(megabytes << 20);
+			}
+			else if (flag == "--order") {
+				if (value == "bfs") { order = contact_graph::ordering::breadth_first; }
+				else if (value == "rcm") { order = contact_graph::ordering::reverse_cuthill_mckee; }
+				else if (value == "degree") { order = contact_graph::ordering::degree; }
+				else { throw std::invalid_argument("Unknown order " + value + "!"); }
+				reorder = true;
+			}
+			else if (flag == "--save") { save_path = value; }
+			else if (flag == "--out") { out_path = value; }
+			else if (flag == "--profile") {
+				if (!tick_profile::enabled) { throw std::invalid_argument("--profile needs a build with SPREAD_PROFILE defined!"); }
+				profile_path = value;
+			}
+			else if (flag == "--format") {
+				if (value != "csv" && value != "binary") { throw std::invalid_argument("Unknown format " + value + "!"); }
+				format = value;
+			}
+			else if (flag == "--mode") {
+				if (value == "immediate") { engine.set_tick_mode(spread_engine::tick_mode::immediate); }
+				else if (value == "synchronous") { engine.set_tick_mode(spread_engine::tick_mode::synchronous); }
+				else if (value == "next_reaction") { engine.set_tick_mode(spread_engine::tick_mode::next_reaction); }
+				else if (value == "tau_leap") { engine.set_tick_mode(spread_engine::tick_mode::tau_leap); }
+				else { throw std::invalid_argument("Unknown mode " + value + "!"); }
+				synchronous = value == "synchronous";
+			}
+			else { throw std::invalid_argument("Unknown argument " + flag + "!"); }
+		}
+		if (!groups.empty()) {
+			if (have_default_flags) {
+				throw std::invalid_argument("--group cannot be combined with --normal, --moron, --mu or their contacts!");
+			}
+			parameters.groups = groups;
+		}
+		else {
+			group_sizes = { num_normal, num_moron };
+		}
+		// a snapshot brings its own population sizes
+		if (load_path.empty() && groups.empty() && !(have_normal && have_moron)) {
+			throw std::invalid_argument("--normal and --moron, or --group, are required without --load!");
+		}
+		if (!have_sick) { throw std::invalid_argument("--sick is required!"); }
+		if (processes == 0) { throw std::invalid_argument("--processes needs at least one process!"); }
+		// workers share the network through a snapshot and trade state between whole ticks
+		if (processes > 1 && (load_path.empty() || !synchronous || !save_path.empty() || reorder)) {
+			throw std::invalid_argument("--processes needs --load and --mode synchronous, and cannot --save or --order!");
+		}
+		// every worker process has its own engine, so only a single process profiles
+		if (processes > 1 && !profile_path.empty()) {
+			throw std::invalid_argument("--profile cannot be combined with --processes!");
+		}
+		engine.set_parameters(parameters);
+		engine.set_interventions(timeline);
+		// a run without --seed uses the engine's random one, reported so it can be repeated
+		if (!have_seed) {
+			seed = engine.get_seed();
+			std::cerr << "seed " << seed << '\n';
+		}
+	}
+	catch (const std::exception& error) {
+		std::cerr << error.what() << '\n';
+		print_usage(std::cerr);
+		return 1;
+	}
+
+	try {
+		const auto start = std::chrono::steady_clock::now();
+
+		// set up the population, from a snapshot if one was given, a partitioned run has
+		// every worker load the snapshot instead
+		if (processes == 1) {
+			engine.set_group_populations(group_sizes, num_sick);
+			if (load_path.empty()) {
+				engine.init_spread_network();
+				engine.populate_spread_network();
+			}
+			else {
+				engine.load_network(load_path);
+			}
+			if (reorder) { engine.reorder_agents(order); }
+			if (!save_path.empty()) { engine.save_network(save_path); }
+			engine.randomly_infect_healthy();
+		}
+
+		const auto setup_done = std::chrono::steady_clock::now();
+
+		// output goes to the file if one was given, else to standard output
+		const bool binary = format == "binary";
+		std::ofstream file;
+		if (!out_path.empty()) {
+			file.open(out_path, binary ? std::ios::binary | std::ios::trunc : std::ios::trunc);
+			if (!file) { throw std::runtime_error("Could not open " + out_path + " for writing!"); }
+		}
+		std::ostream& out = out_path.empty() ? std::cout : file;
+
+		// without a local engine the groups come from the parameters, which must match the snapshot
+		const size_t group_count = processes == 1 ? engine.get_group_count() : parameters.groups.size();
+		if (binary) {
+			const std::uint32_t columns = static_cast<std::uint32_t>(1 + 3 * group_count);
+			out.write(series_magic, sizeof(series_magic));
+			out.write(reinterpret_cast<const char*>(&series_version), sizeof(series_version));
+			out.write(reinterpret_cast<const char*>(&columns), sizeof(columns));
+		}
+		else if (groups.empty()) {
+			out << "day,susceptible_normal,infected_normal,removed_normal,"
+				"susceptible_moron,infected_moron,removed_moron\n";
+		}
+		else {
+			out << "day";
+			for (size_t group = 0; group < group_count; ++group) {
+				out << ",susceptible_" << group << ",infected_" << group << ",removed_" << group;
+			}
+			out << '\n';
+		}
+
+		// tick until nobody is infected or the horizon is reached
+		size_t days_elapsed = 0;
+		if (processes == 1) {
+			write_day(out, binary, day_columns(engine));
+			while (engine.get_total_infected() > 0 &&
+				(days == 0 || engine.get_days_elapsed() < days)) {
+				engine.tick();
+				write_day(out, binary, day_columns(engine));
+			}
+			days_elapsed = engine.get_days_elapsed();
+		}
+		else {
+			partitioned_run run;
+			run.set_snapshot(load_path);
+			run.set_parameters(parameters);
+			run.set_interventions(timeline);
+			run.set_seed(seed);
+			run.set_initial_sick(num_sick);
+			run.set_processes(processes);
+			run.set_threads(threads);
+			run.run(days, [&](const size_t day, const std::vector<size_t>& counts) {
+				std::vector<size_t> columns{ day };
+				columns.insert(columns.end(), counts.begin(), counts.end());
+				write_day(out, binary, columns);
+				days_elapsed = day;
+			});
+		}
+
+		out.flush();
+		if (!out) { throw std::runtime_error("Could not write the output!"); }
+
+		if (!profile_path.empty()) {
+			std::ofstream profile(profile_path, std::ios::trunc);
+			engine.get_profile().write_csv(profile);
+			profile.flush();
+			if (!profile) { throw std::runtime_error("Could not write " + profile_path + "!"); }
+		}
+
+		// timings go to standard error so they never mix with the series
+		const auto finished = std::chrono::steady_clock::now();
+		std::cerr << "setup " << std::chrono::duration<double>(setup_done - start).count() << "s, "
+			<< days_elapsed << " days in "
+			<< std::chrono::duration<double>(finished - setup_done).count() << "s\n";
+	}
+	catch (const std::exception& error) {
+		std::cerr << error.what() << '\n';
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+#ifndef HEADLESS_DRIVER_H
+#define HEADLESS_DRIVER_H
+
+
+/**
+@file headless_driver.h
+@brief Command line driver that runs spread_engine without a window, as fast as the CPU
+allows, and writes each day's S, I and R counts of every group to a file.
+
+	--normal N --moron M --sick K     initial populations (--normal and --moron, or
+	                                  --group, are required without --load)
+	--seed S                          seed of the run, random if not given, in which case
+	                                  it is printed to standard error
+	--days D                          stop after D days even if people are still infected
+	--mode immediate|synchronous|next_reaction|tau_leap
+	                                  tau_leap is approximate, for screening populations too
+	                                  large for the others, see spread_engine::tick_mode
+	--threads T                       threads used by synchronous ticks, per process with
+	                                  --processes
+	--processes P                     with --load and --mode synchronous, splits the
+	                                  population over P worker processes (POSIX only), the
+	                                  counts are those of a single process
+	--propagation auto|push|pull      how synchronous ticks update ill contact counters,
+	                                  see spread_engine::propagation, auto by default
+	--beta B --mu U --gamma G         rates, see spread_parameters
+	--normal-contacts C --moron-contacts C
+	--group SIZE,CONTACTS,MASK        adds a group in place of normal people and morons,
+	                                  repeat for every group (SIZE is ignored with --load)
+	--mixing W,W,...                  group contact matrix, row by row, see spread_parameters
+	--topology MODEL                  network to generate, see network_topology, one of
+	                                  configuration (default, uses the contact numbers),
+	                                  small_world,K,P (K neighbours a side, rewired with P),
+	                                  preferential,M (M attachments per agent) or
+	                                  households,H,W,C (households of H, workplaces of about
+	                                  W, C coworkers a side)
+	--contact-share DAY,S,S,...       from day DAY on, keep only the share S of the contacts
+	                                  between every pair of groups, row by row (see
+	                                  intervention), 1 reopens them all, repeat for every day
+	--mask-scale DAY,F,F,...          from day DAY on, multiply every group's mask by F
+	--load FILE                       use a network snapshot instead of generating one
+	--graph-cache MB                  with --load, megabytes of the snapshot's contacts kept
+	                                  in memory, larger snapshots are streamed from disk
+	                                  each day (use with --mode synchronous)
+	--order bfs|rcm|degree            renumber the agents so contacts sit close together
+	                                  in memory (see contact_graph::ordering), this is a
+	                                  different run of the same epidemic
+	--save FILE                       write the network to a snapshot before running, after
+	                                  --order, so a partitioned run can load it reordered
+	--format csv|binary               output format, csv by default
+	--out FILE                        output file, standard output if not given
+	--profile FILE                    write the time each day's tick spent in its phases and
+	                                  the agents, contacts and draws it went through to FILE
+	                                  as CSV (see tick_profile), needs a build with
+	                                  SPREAD_PROFILE defined and a single process
+
+CSV output has a header row and one row per day, starting with day 0:
+	day,susceptible_normal,infected_normal,removed_normal,susceptible_moron,infected_moron,removed_moron
+or, with --group, day followed by susceptible_G,infected_G,removed_G for every group G.
+Binary output is the 8 byte magic "EPISIR\0\0", a std::uint32_t version (2) and a
+std::uint32_t column count (1 + 3 per group), followed by one row of that many native
+std::uint64_t per day in the same column order (version 1 wrote std::uint32_t, too
+narrow for tau_leap populations past 2^32). The number of rows follows from the
+file size.
+*/
+
+
+/**
+Runs the simulation described by the command line
+@param argc is the argument count passed to main
+@param argv is the argument vector passed to main
+@return is the exit code for main, 0 on success and 1 on bad arguments or I/O errors
+*/
+int run_headless(int argc, char** argv);
+
+#endif // ! HEADLESS_DRIVER_H
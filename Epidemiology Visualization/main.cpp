@@ -1,8 +1,13 @@
 #include "spread_engine.h"
+#include "headless_driver.h"
+#include "simulation_thread.h"
 #include <SFML/Graphics.hpp>
 #include <string>
 
-int main() {
+int main(int argc, char** argv) {
+
+	// any command line arguments run the simulation headless, without opening a window
+	if (argc > 1) { return run_headless(argc, argv); }
 
 	// init render window with 400x400 res, Epidemiology Visualization title
 	static constexpr float window_len = 400;
@@ -157,12 +162,10 @@ int main() {
     bool sim_has_started = false;
     bool sim_has_initialized = false;
  
-    // clock for progressing simulation once per second
-    sf::Clock clock;
-    sf::Time curr_time = sf::seconds(0);
-
-    // initialize spread_engine 
+    // initialize spread_engine, which runs on its own thread so slow ticks
+    // never freeze drawing or input
     spread_engine my_SE;
+    simulation_thread my_sim(my_SE);
 
     while (window.isOpen()) // ensures window is open
     {
@@ -204,6 +207,20 @@ int main() {
                     }
 
                 }
+                // once the sim is running, space pauses and resumes it,
+                // 1 runs it at one day per second and 2 as fast as possible
+                else if (sim_has_started) {
+                    if (event.key.code == sf::Keyboard::Space) {
+                        my_sim.set_speed(my_sim.get_speed() == simulation_thread::sim_speed::paused ?
+                            simulation_thread::sim_speed::one_per_second : simulation_thread::sim_speed::paused);
+                    }
+                    else if (event.key.code == sf::Keyboard::Num1) {
+                        my_sim.set_speed(simulation_thread::sim_speed::one_per_second);
+                    }
+                    else if (event.key.code == sf::Keyboard::Num2) {
+                        my_sim.set_speed(simulation_thread::sim_speed::max_speed);
+                    }
+                }
                 break;
             // user enters text
             case(sf::Event::TextEntered):
@@ -246,52 +263,44 @@ int main() {
         // if simulation has started (i.e. user has pressed enter 3 times)
         if (sim_has_started) {
 
-            // if one second has passed)
-            if (clock.getElapsedTime().asMilliseconds() - curr_time.asMilliseconds() > 999) {
-                // if sim has not yet been initialized
-                if (!sim_has_initialized) {
-                    // set initial pops based on user input
-                    my_SE.set_initial_populations(initial_normal_population, initial_moron_population, initial_sick_population);
-                    // initialize spread network
-                    my_SE.init_spread_network();
-                    // populate each person's network
-                    my_SE.populate_spread_network();
-                    // randomly infect healthy people
-                    my_SE.randomly_infect_healthy();
-                    // set initialized to true to ensure we don't re-initialize
-                    sim_has_initialized = true;
-                    // allow sim to draw sir_bars
-                    for (auto bar : sir_bars) {
-                        to_draw.push_back(bar);
-                    }
+            // if sim has not yet been initialized
+            if (!sim_has_initialized) {
+                // set up the population and start ticking on the simulation thread,
+                // which publishes its counts after setup and after every day
+                my_sim.start(initial_normal_population, initial_moron_population, initial_sick_population);
+                // set initialized to true to ensure we don't re-initialize
+                sim_has_initialized = true;
+                // allow sim to draw sir_bars
+                for (auto bar : sir_bars) {
+                    to_draw.push_back(bar);
                 }
+            }
+
+            // newest counts from the simulation thread, never waits on a tick
+            const simulation_thread::snapshot& counts = my_sim.latest();
 
-                
+            // bars stay empty until the population has been set up
+            if (counts.ready) {
                 // total population size_t for reference so that each bar is proportional to total population
                 size_t initial_total_population = initial_moron_population + initial_normal_population;
-                
+
                 //set each bar width to ( (its corresponding population / total population) * maximum length)
                 normal_s_bar.setSize(sf::Vector2f(
-                    max_bar_len * (static_cast<float>(my_SE.get_susceptible_normal()) / initial_total_population), 22.f));
+                    max_bar_len * (static_cast<float>(counts.susceptible_normal) / initial_total_population), 22.f));
                 normal_i_bar.setSize(sf::Vector2f(
-                    max_bar_len * (static_cast<float>(my_SE.get_infected_normal()) / initial_total_population), 22.f));
+                    max_bar_len * (static_cast<float>(counts.infected_normal) / initial_total_population), 22.f));
                 normal_r_bar.setSize(sf::Vector2f(
-                    max_bar_len * (static_cast<float>(my_SE.get_removed_normal()) / initial_total_population), 22.f));
+                    max_bar_len * (static_cast<float>(counts.removed_normal) / initial_total_population), 22.f));
                 moron_s_bar.setSize(sf::Vector2f(
-                    max_bar_len * (static_cast<float>(my_SE.get_susceptible_moron()) / initial_total_population), 22.f));
+                    max_bar_len * (static_cast<float>(counts.susceptible_moron) / initial_total_population), 22.f));
                 moron_i_bar.setSize(sf::Vector2f(
-                    max_bar_len * (static_cast<float>(my_SE.get_infected_moron()) / initial_total_population), 22.f));
+                    max_bar_len * (static_cast<float>(counts.infected_moron) / initial_total_population), 22.f));
                 moron_r_bar.setSize(sf::Vector2f(
-                    max_bar_len * (static_cast<float>(my_SE.get_removed_moron()) / initial_total_population), 22.f));
-
-                // reset current time for second counting
-                curr_time = clock.getElapsedTime();
-                // set day counting string to new days elapsed
-                day_count.setString(std::to_string(my_SE.get_days_elapsed()));
-
+                    max_bar_len * (static_cast<float>(counts.removed_moron) / initial_total_population), 22.f));
 
-                // call forwarding function to continue the simulation
-                my_SE.tick();
+                // set day counting string to the published day, marked while paused
+                day_count.setString(std::to_string(counts.day) +
+                    (my_sim.get_speed() == simulation_thread::sim_speed::paused ? " (paused)" : ""));
             }
         }
        
@@ -0,0 +1,140 @@
+#include "mapped_file.h"
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// page size the advised ranges are aligned to
+static size_t page_bytes() {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return static_cast<size_t>(info.dwPageSize);
+#else
+	return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::string& path) : bytes(nullptr), length(0), file_handle(nullptr), mapping_handle(nullptr) {
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Could not open " + path + "!");
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Could not read the size of " + path + "!");
+	}
+	length = static_cast<size_t>(file_size.QuadPart);
+	file_handle = file;
+
+	// a zero length file cannot be mapped, it is left as an empty range
+	if (length == 0) { return; }
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		throw std::runtime_error("Could not map " + path + "!");
+	}
+	mapping_handle = mapping;
+	bytes = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (bytes == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("Could not map " + path + "!");
+	}
+}
+
+mapped_file::~mapped_file() {
+	if (bytes != nullptr) { UnmapViewOfFile(bytes); }
+	if (mapping_handle != nullptr) { CloseHandle(mapping_handle); }
+	if (file_handle != nullptr) { CloseHandle(file_handle); }
+}
+
+#else
+
+mapped_file::mapped_file(const std::string& path) : bytes(nullptr), length(0) {
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		throw std::runtime_error("Could not open " + path + "!");
+	}
+	struct stat info;
+	if (fstat(file, &info) != 0) {
+		close(file);
+		throw std::runtime_error("Could not read the size of " + path + "!");
+	}
+	length = static_cast<size_t>(info.st_size);
+
+	// a zero length file cannot be mapped, it is left as an empty range
+	if (length > 0) {
+		void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+		if (mapping == MAP_FAILED) {
+			close(file);
+			throw std::runtime_error("Could not map " + path + "!");
+		}
+		bytes = static_cast<const unsigned char*>(mapping);
+	}
+	// the mapping keeps the file alive on its own
+	close(file);
+}
+
+mapped_file::~mapped_file() {
+	if (bytes != nullptr) { munmap(const_cast<unsigned char*>(bytes), length); }
+}
+
+#endif
+
+const unsigned char* mapped_file::data() const { return bytes; }
+size_t mapped_file::size() const { return length; }
+
+void mapped_file::advise(const size_t offset, const size_t bytes_advised, const access expected) const {
+	if (bytes == nullptr || offset >= length || bytes_advised == 0) { return; }
+	static const size_t page = page_bytes();
+
+	// pages about to be read are widened to whole pages, pages to drop are narrowed to
+	// the ones entirely inside the range so neighbouring data is never thrown out
+	const size_t end = std::min(length, offset + bytes_advised);
+	size_t first = offset / page * page;
+	size_t last = (end + page - 1) / page * page;
+	if (expected == access::dont_need) {
+		first = (offset + page - 1) / page * page;
+		last = end == length ? last : end / page * page;
+	}
+	if (first >= last) { return; }
+	unsigned char* start = const_cast<unsigned char*>(bytes) + first;
+
+#ifdef _WIN32
+	// Windows 8 and later can read a range ahead, it has no equivalent of the other hints
+	if (expected == access::will_need) {
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = start;
+		range.NumberOfBytes = last - first;
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	// madvise rather than posix_madvise, whose dont_need glibc ignores. The mapping is
+	// private and read-only, so dropped pages are simply read from the file again
+	int advice = MADV_NORMAL;
+	switch (expected) {
+	case access::normal: advice = MADV_NORMAL; break;
+	case access::sequential: advice = MADV_SEQUENTIAL; break;
+	case access::random: advice = MADV_RANDOM; break;
+	case access::will_need: advice = MADV_WILLNEED; break;
+	case access::dont_need: advice = MADV_DONTNEED; break;
+	}
+	// a failed hint changes nothing, so the result is not checked
+	madvise(start, last - first, advice);
+#endif
+}
@@ -0,0 +1,87 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+
+/**
+@class mapped_file
+@brief The mapped_file class maps a whole file read-only into memory and unmaps it when
+destroyed, with mmap on POSIX systems and CreateFileMapping on Windows.
+
+Pages are only read from disk when first touched, so opening even a very large file
+is immediate and memory the operating system can evict under pressure. Files larger
+than physical memory can be mapped too, advise tells the operating system which pages
+are needed next and which can go, so scanning them costs disk reads rather than swap.
+*/
+class mapped_file
+{
+public:
+	/**
+	@enum access
+	@brief Expected use of a range of the mapping, see advise
+	*/
+	enum class access {
+		// the operating system's default read-ahead
+		normal,
+		// read front to back, read-ahead aggressively and drop pages once passed
+		sequential,
+		// read in no particular order, read-ahead would be wasted
+		random,
+		// needed soon, start reading it in now
+		will_need,
+		// not needed for a while, the pages can be dropped straight away
+		dont_need
+	};
+
+private:
+	// start of the mapping, nullptr for an empty file
+	const unsigned char* bytes;
+	// length of the file in bytes
+	size_t length;
+#ifdef _WIN32
+	// file and mapping handles, kept as void* so windows.h stays out of this header
+	void* file_handle;
+	void* mapping_handle;
+#endif
+
+public:
+
+	/**
+	Maps a file
+	@param path is the file to map
+	@throws std::runtime_error if the file cannot be opened or mapped
+	*/
+	explicit mapped_file(const std::string& path);
+	// unmaps the file and closes its handles
+	~mapped_file();
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	/**
+	Getter for the start of the mapping
+	@return is a pointer to the first byte of the file, page aligned
+	*/
+	const unsigned char* data() const;
+
+	/**
+	Getter for the length of the mapping
+	@return is a size_t corresponding to the file's length in bytes
+	*/
+	size_t size() const;
+
+	/**
+	@brief Tells the operating system how a range of the file will be used. This is
+	only a hint, the mapping reads the same whatever is advised, and a range outside
+	the file or a platform without the hint is silently ignored. On Windows only
+	will_need has an effect
+	@param offset is the first byte of the range
+	@param bytes is the length of the range
+	@param expected is how the range will be used
+	*/
+	void advise(const size_t offset, const size_t bytes, const access expected) const;
+};
+
+#endif // ! MAPPED_FILE_H
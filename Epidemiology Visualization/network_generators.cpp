@@ -0,0 +1,259 @@
+#include "network_generators.h"
+#include "spread_rng.h"
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <memory>
+
+using agent_id = contact_graph::agent_id;
+using edge_index = contact_graph::edge_index;
+
+// kinds of draws made while generating, kept clear of the kinds a tick draws
+enum generator_draw : std::uint32_t { small_world_draw = 16, rewire_draw = 17, attachment_draw = 18, workplace_draw = 19 };
+
+// edges and agents are handed to the workers in chunks of this many
+static constexpr size_t generator_chunk = size_t(1) << 16;
+
+// Philox block of a 64 bit index, the high half of the index picks the stream
+static std::array<std::uint32_t, 4> index_block(const std::uint64_t seed, const generator_draw kind, const std::uint64_t index) {
+	return philox_stream(seed, index >> 32, kind).block(static_cast<std::uint32_t>(index));
+}
+
+// raw word scaled to a number in [0, range), range at most 2^32
+static std::uint64_t scale(const std::uint32_t word, const std::uint64_t range) {
+	return (std::uint64_t(word) * range) >> 32;
+}
+
+/**
+@struct id_spreader
+@brief Affine permutation i -> (i * stride + shift) % agents, spreads agents that a model
+joins by agent_id over the whole population (and so over every group)
+*/
+struct id_spreader {
+	std::uint64_t agents, stride, shift;
+
+	id_spreader(const size_t population, std::uint64_t seed) : agents(population), stride(1), shift(0) {
+		if (agents < 2) { return; }
+		// a stride near agents / golden ratio that shares no factor with agents is a bijection
+		stride = static_cast<std::uint64_t>(static_cast<double>(agents) * 0.6180339887498949) | 1;
+		while (std::gcd(stride, agents) != 1) { ++stride; }
+		shift = splitmix64(seed) % agents;
+	}
+
+	agent_id operator()(const std::uint64_t i) const { return static_cast<agent_id>((i * stride + shift) % agents); }
+};
+
+// ends of one edge, u == v marks a slot the model leaves empty
+using edge_ends = std::pair<agent_id, agent_id>;
+
+// the edges are made in this many parts, whatever the number of threads
+static constexpr size_t edge_parts = 64;
+
+// adds one to a cursor and gives its old value, only paying for an atomic add when
+// other threads may be adding to it too
+static edge_index claim(std::atomic<edge_index>& cursor, const bool shared) {
+	if (shared) { return cursor.fetch_add(1, std::memory_order_relaxed); }
+	const edge_index old = cursor.load(std::memory_order_relaxed);
+	cursor.store(old + 1, std::memory_order_relaxed);
+	return old;
+}
+
+// builds a graph from a model whose edges are numbered 0 to edges - 1,
+// make_edges(first, last, out) writes the ends of edges first to last - 1 to out, and
+// must write the same ends every time it is called.
+//
+// The edges are made twice rather than being stored in between: once to count every
+// agent's contacts, which gives the CSR offsets, and once to write both directions of
+// each edge straight into its agents' slices. Parts claim slots in a slice through the
+// agent's atomic cursor, so slices fill in whatever order the threads get there, and
+// sorting each slice afterwards takes that order away again and drops duplicates.
+// Besides the graph itself only one 8 byte cursor per agent is held
+template <typename edge_model>
+static void assemble(contact_graph& graph, const size_t agents, const std::uint64_t edges, const edge_model& make_edges,
+	worker_pool& workers) {
+
+	const std::uint64_t part_edges = (edges + edge_parts - 1) / edge_parts;
+
+	// runs visit(u, v) on every non-empty edge of a part, in order
+	auto for_part = [&](const size_t part, auto&& visit) {
+		std::vector<edge_ends> batch(generator_chunk);
+		const std::uint64_t part_last = std::min(edges, (part + 1) * part_edges);
+		for (std::uint64_t first = part * part_edges; first < part_last; first += generator_chunk) {
+			const std::uint64_t last = std::min<std::uint64_t>(part_last, first + generator_chunk);
+			make_edges(first, last, batch.data());
+			for (size_t i = 0; i < last - first; ++i) {
+				if (batch[i].first != batch[i].second) { visit(batch[i].first, batch[i].second); }
+			}
+		}
+	};
+
+	// every part counts the contacts of the agents its edges join, the counts then become
+	// the first slot of each agent's slice
+	const bool shared = workers.size() > 1;
+	std::unique_ptr<std::atomic<edge_index>[]> next_slot(new std::atomic<edge_index>[agents]);
+	for (size_t i = 0; i < agents; ++i) { next_slot[i].store(0, std::memory_order_relaxed); }
+	workers.run(edge_parts, [&](const size_t part) {
+		for_part(part, [&](const agent_id u, const agent_id v) {
+			claim(next_slot[u], shared);
+			claim(next_slot[v], shared);
+		});
+	});
+	edge_index slots = 0;
+	for (size_t i = 0; i < agents; ++i) {
+		const edge_index contacts = next_slot[i].load(std::memory_order_relaxed);
+		next_slot[i].store(slots, std::memory_order_relaxed);
+		slots += contacts;
+	}
+
+	// the same edges again, each direction into the next free slot of its agent, which
+	// leaves next_slot at the end of every slice
+	std::vector<agent_id> neighbors(static_cast<size_t>(slots));
+	workers.run(edge_parts, [&](const size_t part) {
+		for_part(part, [&](const agent_id u, const agent_id v) {
+			neighbors[static_cast<size_t>(claim(next_slot[u], shared))] = v;
+			neighbors[static_cast<size_t>(claim(next_slot[v], shared))] = u;
+		});
+	});
+	std::vector<edge_index> offsets(agents + 1, 0);
+	for (size_t i = 0; i < agents; ++i) { offsets[i + 1] = next_slot[i].load(std::memory_order_relaxed); }
+
+	// sorting each slice puts duplicate edges next to each other, next_slot ends up with
+	// each agent's distinct contacts
+	const size_t agent_chunks = (agents + generator_chunk - 1) / generator_chunk;
+	workers.run(agent_chunks, [&](const size_t chunk) {
+		const size_t last_agent = std::min(agents, (chunk + 1) * generator_chunk);
+		for (size_t i = chunk * generator_chunk; i < last_agent; ++i) {
+			const auto first = neighbors.begin() + static_cast<std::ptrdiff_t>(offsets[i]);
+			const auto end = neighbors.begin() + static_cast<std::ptrdiff_t>(offsets[i + 1]);
+			std::sort(first, end);
+			next_slot[i].store(static_cast<edge_index>(std::unique(first, end) - first), std::memory_order_relaxed);
+		}
+	});
+
+	// close the gaps duplicates left, slices only ever move towards the front. Duplicates
+	// are rare, so the slots they free stay allocated rather than the array being copied
+	edge_index packed = 0;
+	for (size_t i = 0; i < agents; ++i) {
+		const edge_index distinct = next_slot[i].load(std::memory_order_relaxed);
+		if (packed != offsets[i]) {
+			const auto first = neighbors.begin() + static_cast<std::ptrdiff_t>(offsets[i]);
+			std::copy(first, first + static_cast<std::ptrdiff_t>(distinct), neighbors.begin() + static_cast<std::ptrdiff_t>(packed));
+		}
+		offsets[i] = packed;
+		packed += distinct;
+	}
+	offsets[agents] = packed;
+	next_slot.reset();
+	neighbors.resize(static_cast<size_t>(packed));
+
+	graph.assign(std::move(offsets), std::move(neighbors));
+}
+
+void generate_small_world(contact_graph& graph, const size_t agents, const network_topology& topology,
+	const std::uint64_t seed, worker_pool& workers) {
+
+	const std::uint64_t neighbors = topology.ring_neighbors;
+	const std::uint64_t rewire_below = static_cast<std::uint64_t>(topology.rewiring * 4294967296.0);
+	const id_spreader label(agents, seed);
+
+	// edge e joins ring position e / neighbors to the one (e % neighbors) + 1 further on,
+	// whether it is rewired is word e of one stream (four edges share a block), and only
+	// rewired edges draw their new far end from a second stream
+	assemble(graph, agents, agents * neighbors, [&](const std::uint64_t first, const std::uint64_t last, edge_ends* out) {
+		std::array<std::uint32_t, 4> decisions = index_block(seed, small_world_draw, first >> 2);
+		for (std::uint64_t e = first; e < last; ++e) {
+			if ((e & 3) == 0) { decisions = index_block(seed, small_world_draw, e >> 2); }
+			const std::uint64_t near_end = e / neighbors;
+			std::uint64_t far_end = (near_end + e % neighbors + 1) % agents;
+			if (decisions[e & 3] < rewire_below) {
+				// a second pick covers landing on the near end
+				const std::array<std::uint32_t, 4> picks = index_block(seed, rewire_draw, e);
+				std::uint64_t pick = scale(picks[0], agents);
+				if (pick == near_end) { pick = scale(picks[1], agents); }
+				if (pick != near_end) { far_end = pick; }
+			}
+			out[e - first] = { label(near_end), label(far_end) };
+		}
+	}, workers);
+}
+
+void generate_preferential_attachment(contact_graph& graph, const size_t agents, const network_topology& topology,
+	const std::uint64_t seed, worker_pool& workers) {
+
+	const std::uint64_t attachments = topology.attachments;
+	const id_spreader label(agents, seed);
+
+	// Batagelj and Brandes: edge e = agent * attachments + i fills slots 2e and 2e + 1 of
+	// a list where every agent appears once per contact. Slot 2e holds the agent, and slot
+	// 2e + 1 copies a uniformly random earlier slot, which picks an agent in proportion to
+	// their contacts. What an odd slot copies is a draw keyed by the slot, so it is the
+	// same whoever follows it, and every edge can follow its copies back to an even slot
+	// on its own (two steps on average)
+	assemble(graph, agents, agents * attachments, [&](const std::uint64_t first, const std::uint64_t last, edge_ends* out) {
+		for (std::uint64_t e = first; e < last; ++e) {
+			std::uint64_t slot = 2 * e + 1;
+			while (slot & 1) {
+				const std::array<std::uint32_t, 4> words = index_block(seed, attachment_draw, slot >> 1);
+				slot = ((std::uint64_t(words[0]) << 32) | words[1]) % slot;
+			}
+			out[e - first] = { label(e / attachments), label(slot / 2 / attachments) };
+		}
+	}, workers);
+}
+
+void generate_households(contact_graph& graph, const size_t agents, const network_topology& topology,
+	const std::uint64_t seed, worker_pool& workers) {
+
+	const std::uint64_t household_size = topology.household_size;
+	const std::uint64_t coworkers = topology.workplace_neighbors;
+	const size_t workplaces = std::max<size_t>(1, (agents + topology.workplace_size - 1) / topology.workplace_size);
+	const id_spreader label(agents, seed);
+	const size_t agent_chunks = (agents + generator_chunk - 1) / generator_chunk;
+
+	// everyone draws a workplace
+	std::vector<std::uint32_t> workplace(agents);
+	workers.run(agent_chunks, [&](const size_t chunk) {
+		const size_t first = chunk * generator_chunk;
+		const size_t last = std::min(agents, first + generator_chunk);
+		std::array<std::uint32_t, 4> words{};
+		for (size_t i = first; i < last; ++i) {
+			if (i == first || (i & 3) == 0) { words = index_block(seed, workplace_draw, i >> 2); }
+			workplace[i] = static_cast<std::uint32_t>(scale(words[i & 3], workplaces));
+		}
+	});
+
+	// members lists each workplace's staff back to back, in agent_id order
+	std::vector<std::uint32_t> staff_start(workplaces + 1, 0);
+	for (size_t i = 0; i < agents; ++i) { ++staff_start[workplace[i] + 1]; }
+	std::partial_sum(staff_start.begin(), staff_start.end(), staff_start.begin());
+	std::vector<agent_id> members(agents);
+	{
+		std::vector<std::uint32_t> filled(staff_start.begin(), staff_start.end() - 1);
+		for (size_t i = 0; i < agents; ++i) { members[filled[workplace[i]]++] = static_cast<agent_id>(i); }
+	}
+
+	// household edge e joins agent e / (household_size - 1) to each later member of their
+	// household, workplace edge e joins the member at position e / coworkers of members to
+	// the one (e % coworkers) + 1 further round their workplace
+	const std::uint64_t household_edges = agents * (household_size - 1);
+	assemble(graph, agents, household_edges + agents * coworkers, [&](const std::uint64_t first, const std::uint64_t last, edge_ends* out) {
+		for (std::uint64_t e = first; e < last; ++e) {
+			if (e < household_edges) {
+				const std::uint64_t person = e / (household_size - 1);
+				const std::uint64_t housemate = person + 1 + e % (household_size - 1);
+				const std::uint64_t household_end = std::min<std::uint64_t>(agents, (person / household_size + 1) * household_size);
+				// slots past the end of the household stay empty
+				out[e - first] = { label(person), label(housemate < household_end ? housemate : person) };
+				continue;
+			}
+			const std::uint64_t position = (e - household_edges) / coworkers;
+			const std::uint64_t step = (e - household_edges) % coworkers + 1;
+			const agent_id member = members[static_cast<size_t>(position)];
+			const std::uint64_t staff_first = staff_start[workplace[member]];
+			const std::uint64_t staff = staff_start[workplace[member] + 1] - staff_first;
+			out[e - first] = { label(member), label(members[static_cast<size_t>(staff_first + (position - staff_first + step) % staff)]) };
+		}
+	}, workers);
+}
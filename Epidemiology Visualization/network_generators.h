@@ -0,0 +1,65 @@
+#ifndef NETWORK_GENERATORS_H
+#define NETWORK_GENERATORS_H
+
+#include <cstdint>
+#include <cstddef>
+#include "contact_graph.h"
+#include "worker_pool.h"
+#include "spread_parameters.h"
+
+
+/**
+@file network_generators.h
+@brief Parallel generators for the network_topology models other than the configuration
+network, which populate_spread_network builds itself.
+
+Every edge of a model is a pure function of the seed and the edge's index, drawn from a
+philox_stream, so the edges can be made on any thread in any order. The generators make
+them twice, once to count each agent's contacts and once to write them straight into
+the graph's CSR arrays, so no edge list is ever stored. Each agent's contacts are then
+sorted, which drops self-loops and duplicate edges and makes the graph the same for a
+seed whatever the number of threads. At its peak generating takes the finished graph's
+memory plus 8 bytes per agent for the slice cursors.
+
+Models that join agents by agent_id (rings, households, arrival order) would put whole
+neighbourhoods in one group, as groups hold consecutive agents, so the ids are spread
+over the population with a seeded affine permutation first. reorder_agents can bring
+neighbours back together afterwards.
+*/
+
+
+/**
+Generates a Watts-Strogatz small-world network
+@param graph receives the network
+@param agents is the number of agents, more than twice topology.ring_neighbors
+@param topology gives ring_neighbors and rewiring
+@param seed is the run's seed
+@param workers are the threads to generate on
+*/
+void generate_small_world(contact_graph& graph, const size_t agents, const network_topology& topology,
+	const std::uint64_t seed, worker_pool& workers);
+
+/**
+Generates a Barabasi-Albert preferential attachment network, each agent joins up to
+topology.attachments earlier agents (fewer when a pick repeats)
+@param graph receives the network
+@param agents is the number of agents
+@param topology gives attachments
+@param seed is the run's seed
+@param workers are the threads to generate on
+*/
+void generate_preferential_attachment(contact_graph& graph, const size_t agents, const network_topology& topology,
+	const std::uint64_t seed, worker_pool& workers);
+
+/**
+Generates a household and workplace block network
+@param graph receives the network
+@param agents is the number of agents
+@param topology gives household_size, workplace_size and workplace_neighbors
+@param seed is the run's seed
+@param workers are the threads to generate on
+*/
+void generate_households(contact_graph& graph, const size_t agents, const network_topology& topology,
+	const std::uint64_t seed, worker_pool& workers);
+
+#endif // ! NETWORK_GENERATORS_H
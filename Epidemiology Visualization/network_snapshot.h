@@ -0,0 +1,84 @@
+#ifndef NETWORK_SNAPSHOT_H
+#define NETWORK_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+
+/**
+@file network_snapshot.h
+@brief Layout of the binary snapshot files written by spread_engine::save_network.
+
+A snapshot is a snapshot_header followed by three sections, each starting on a
+snapshot_alignment boundary:
+	offsets:   population + 1 std::uint64_t CSR offsets
+	neighbors: edge_slots std::uint32_t agent ids
+	groups:    population std::uint8_t agent groups
+The sections are stored exactly as they sit in memory, so a mapped file is used in place
+with no parsing. Files are only readable on machines of the byte order they were
+written on, which byte_order records.
+*/
+
+// identifies a snapshot file
+static constexpr char snapshot_magic[8] = { 'E', 'P', 'I', 'N', 'E', 'T', '\0', '\0' };
+// bumped whenever the layout changes, older files are rejected rather than misread.
+// Version 1 had the same layout for the two default groups, with a count of morons
+// where group_count is now, and is still read as a two group snapshot
+static constexpr std::uint32_t snapshot_version = 2;
+static constexpr std::uint32_t snapshot_two_group_version = 1;
+// written as a native integer, reads back differently on a machine of the other byte order
+static constexpr std::uint32_t snapshot_byte_order = 0x01020304u;
+// sections start on cache line boundaries
+static constexpr std::uint64_t snapshot_alignment = 64;
+
+/**
+@struct snapshot_header
+@brief First 64 bytes of a snapshot file, section positions are byte offsets from the
+start of the file
+*/
+struct snapshot_header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byte_order;
+	std::uint64_t population;
+	std::uint64_t group_count;
+	std::uint64_t edge_slots;
+	std::uint64_t offsets_at;
+	std::uint64_t neighbors_at;
+	std::uint64_t groups_at;
+};
+static_assert(sizeof(snapshot_header) == 64, "snapshot_header must stay 64 bytes");
+
+/**
+Rounds a file position up to the next section boundary
+@param position is a byte offset
+@return is a std::uint64_t corresponding to the first aligned offset at or after position
+*/
+inline std::uint64_t snapshot_align(const std::uint64_t position) {
+	return (position + snapshot_alignment - 1) / snapshot_alignment * snapshot_alignment;
+}
+
+/**
+Fills in a header for a network
+@param population is the number of agents
+@param group_count is the number of agent groups
+@param edge_slots is the length of the neighbors array
+@return is a snapshot_header with every section placed
+*/
+inline snapshot_header make_snapshot_header(const std::uint64_t population, const std::uint64_t group_count,
+	const std::uint64_t edge_slots) {
+	snapshot_header header;
+	std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+	header.version = snapshot_version;
+	header.byte_order = snapshot_byte_order;
+	header.population = population;
+	header.group_count = group_count;
+	header.edge_slots = edge_slots;
+	header.offsets_at = snapshot_align(sizeof(snapshot_header));
+	header.neighbors_at = snapshot_align(header.offsets_at + (population + 1) * sizeof(std::uint64_t));
+	header.groups_at = snapshot_align(header.neighbors_at + edge_slots * sizeof(std::uint32_t));
+	return header;
+}
+
+#endif // ! NETWORK_SNAPSHOT_H
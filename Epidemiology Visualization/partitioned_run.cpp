@@ -0,0 +1,236 @@
+#include "partitioned_run.h"
+#include "spread_engine.h"
+#include <stdexcept>
+#include <iostream>
+#include <random>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cerrno>
+#endif
+
+// default constructor, seeds from std::random_device like spread_engine
+partitioned_run::partitioned_run() :
+	seed((std::uint64_t(std::random_device{}()) << 32) | std::random_device{}()),
+	num_sick(0), processes(2), threads(1) {}
+
+void partitioned_run::set_snapshot(const std::string& path) { snapshot_path = path; }
+void partitioned_run::set_parameters(const spread_parameters& new_parameters) { parameters = new_parameters; }
+void partitioned_run::set_interventions(const std::vector<intervention>& timeline) { interventions = timeline; }
+void partitioned_run::set_seed(const std::uint64_t new_seed) { seed = new_seed; }
+void partitioned_run::set_initial_sick(const size_t sick) { num_sick = sick; }
+void partitioned_run::set_processes(const size_t count) { processes = count; }
+void partitioned_run::set_threads(const size_t count) { threads = count; }
+
+#ifdef _WIN32
+
+void partitioned_run::run(const size_t, const std::function<void(size_t, const std::vector<size_t>&)>&) {
+	throw std::runtime_error("Partitioned runs need fork and Unix sockets, which this platform lacks!");
+}
+
+#else
+
+// writes a whole buffer to a socket, retrying short writes
+static void write_all(const int socket, const void* data, size_t bytes) {
+	const char* next = static_cast<const char*>(data);
+	while (bytes > 0) {
+		const ssize_t written = write(socket, next, bytes);
+		if (written < 0 && errno == EINTR) { continue; }
+		if (written <= 0) { throw std::runtime_error("A partition's connection was lost!"); }
+		next += written;
+		bytes -= static_cast<size_t>(written);
+	}
+}
+
+// reads a whole buffer from a socket, retrying short reads
+static void read_all(const int socket, void* data, size_t bytes) {
+	char* next = static_cast<char*>(data);
+	while (bytes > 0) {
+		const ssize_t got = read(socket, next, bytes);
+		if (got < 0 && errno == EINTR) { continue; }
+		if (got <= 0) { throw std::runtime_error("A partition's connection was lost!"); }
+		next += got;
+		bytes -= static_cast<size_t>(got);
+	}
+}
+
+// a list of updates goes as its length followed by its entries
+static void write_updates(const int socket, const std::vector<halo_update>& updates) {
+	const std::uint64_t count = updates.size();
+	write_all(socket, &count, sizeof(count));
+	write_all(socket, updates.data(), updates.size() * sizeof(halo_update));
+}
+static void read_updates(const int socket, std::vector<halo_update>& updates) {
+	std::uint64_t count = 0;
+	read_all(socket, &count, sizeof(count));
+	updates.resize(static_cast<size_t>(count));
+	read_all(socket, updates.data(), updates.size() * sizeof(halo_update));
+}
+
+/**
+@class socket_channel
+@brief Worker side of the halo exchange: sends one list per partition to the parent,
+then waits for the parent to send back this partition's updates
+*/
+class socket_channel : public halo_channel
+{
+private:
+	int socket;
+
+public:
+	explicit socket_channel(const int parent_socket) : socket(parent_socket) {}
+
+	void exchange(const std::vector<std::vector<halo_update>>& outgoing, std::vector<halo_update>& incoming) override {
+		for (const std::vector<halo_update>& updates : outgoing) { write_updates(socket, updates); }
+		read_updates(socket, incoming);
+	}
+};
+
+// body of a worker process: sets up its partition, then alternates between ticking and
+// reporting its counts until the parent says stop
+static void run_worker(const int socket, const size_t index, const size_t processes, const std::string& snapshot_path,
+	const spread_parameters& parameters, const std::vector<intervention>& interventions, const std::uint64_t seed,
+	const size_t num_sick, const size_t threads) {
+
+	spread_engine engine;
+	engine.set_seed(seed);
+	engine.set_threads(threads);
+	engine.set_tick_mode(spread_engine::tick_mode::synchronous);
+	engine.set_parameters(parameters);
+	engine.set_interventions(interventions);
+	engine.set_initial_populations(0, 0, num_sick);
+
+	socket_channel channel(socket);
+	engine.load_partition(snapshot_path, processes, index, channel);
+	engine.randomly_infect_healthy();
+
+	const size_t groups = engine.get_group_count();
+	std::vector<std::uint64_t> counts(3 * groups);
+	for (;;) {
+		for (size_t group = 0; group < groups; ++group) {
+			counts[group * 3] = engine.get_susceptible(group);
+			counts[group * 3 + 1] = engine.get_infected(group);
+			counts[group * 3 + 2] = engine.get_removed(group);
+		}
+		write_all(socket, counts.data(), counts.size() * sizeof(std::uint64_t));
+
+		std::uint8_t keep_going = 0;
+		read_all(socket, &keep_going, sizeof(keep_going));
+		if (!keep_going) { return; }
+		engine.tick();
+	}
+}
+
+void partitioned_run::run(const size_t days, const std::function<void(size_t, const std::vector<size_t>&)>& report) {
+	if (processes == 0) {
+		throw std::logic_error("A partitioned run needs at least one process!");
+	}
+	if (snapshot_path.empty()) {
+		throw std::logic_error("A partitioned run needs a network snapshot!");
+	}
+
+	// anything buffered would otherwise be written once by every worker as well
+	std::cout.flush();
+	std::cerr.flush();
+
+	// one socket pair per worker, the parent keeps one end and the worker the other
+	std::vector<int> sockets;
+	std::vector<pid_t> workers;
+	auto stop_workers = [&]() {
+		for (int socket : sockets) { close(socket); }
+		for (pid_t worker : workers) { kill(worker, SIGTERM); waitpid(worker, nullptr, 0); }
+	};
+
+	for (size_t index = 0; index < processes; ++index) {
+		int pair[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+			stop_workers();
+			throw std::runtime_error("Could not create a socket pair for a partition!");
+		}
+		const pid_t worker = fork();
+		if (worker < 0) {
+			close(pair[0]);
+			close(pair[1]);
+			stop_workers();
+			throw std::runtime_error("Could not start a partition process!");
+		}
+		if (worker == 0) {
+			// the worker only keeps its own end, and leaves with _exit so nothing of the
+			// parent's is flushed or destroyed twice
+			close(pair[0]);
+			for (int socket : sockets) { close(socket); }
+			int status = 0;
+			try {
+				run_worker(pair[1], index, processes, snapshot_path, parameters, interventions, seed, num_sick, threads);
+			}
+			catch (const std::exception& error) {
+				std::cerr << "partition " << index << ": " << error.what() << '\n';
+				status = 1;
+			}
+			std::cerr.flush();
+			_exit(status);
+		}
+		close(pair[1]);
+		sockets.push_back(pair[0]);
+		workers.push_back(worker);
+	}
+
+	try {
+		const size_t groups = parameters.groups.size();
+		std::vector<std::uint64_t> partition_counts(3 * groups);
+		std::vector<size_t> totals(3 * groups);
+		std::vector<std::vector<std::vector<halo_update>>> sent(processes, std::vector<std::vector<halo_update>>(processes));
+		std::vector<halo_update> routed;
+
+		for (size_t day = 0; ; ++day) {
+			// every worker reports the counts of its partition after each day
+			std::fill(totals.begin(), totals.end(), 0);
+			for (int socket : sockets) {
+				read_all(socket, partition_counts.data(), partition_counts.size() * sizeof(std::uint64_t));
+				for (size_t i = 0; i < totals.size(); ++i) { totals[i] += static_cast<size_t>(partition_counts[i]); }
+			}
+			report(day, totals);
+
+			size_t infected = 0;
+			for (size_t group = 0; group < groups; ++group) { infected += totals[group * 3 + 1]; }
+			const std::uint8_t keep_going = infected > 0 && (days == 0 || day < days);
+			for (int socket : sockets) { write_all(socket, &keep_going, sizeof(keep_going)); }
+			if (!keep_going) { break; }
+
+			// halo exchange: collect every worker's lists, a worker that is still writing
+			// never waits on anything, so reading them one after the other cannot deadlock
+			for (size_t from = 0; from < processes; ++from) {
+				for (size_t to = 0; to < processes; ++to) { read_updates(sockets[from], sent[from][to]); }
+			}
+			// then hand each worker everything addressed to it, in order of the sender
+			for (size_t to = 0; to < processes; ++to) {
+				routed.clear();
+				for (size_t from = 0; from < processes; ++from) {
+					routed.insert(routed.end(), sent[from][to].begin(), sent[from][to].end());
+				}
+				write_updates(sockets[to], routed);
+			}
+		}
+	}
+	catch (...) {
+		stop_workers();
+		throw;
+	}
+
+	// workers leave on their own once told to stop
+	for (int socket : sockets) { close(socket); }
+	bool failed = false;
+	for (pid_t worker : workers) {
+		int status = 0;
+		waitpid(worker, &status, 0);
+		failed = failed || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+	}
+	if (failed) {
+		throw std::runtime_error("A partition process failed!");
+	}
+}
+
+#endif
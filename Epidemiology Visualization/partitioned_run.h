@@ -0,0 +1,101 @@
+#ifndef PARTITIONED_RUN_H
+#define PARTITIONED_RUN_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include "spread_parameters.h"
+
+
+/**
+@class partitioned_run
+@brief The partitioned_run class runs one population split over several worker
+processes on a POSIX system, each simulating a contiguous range of agent ids with its
+own spread_engine (see spread_engine::load_partition).
+
+Every worker maps the same network snapshot but only reads the contacts of its own
+agents, and keeps those agents and ghost copies of their contacts elsewhere under ids
+of its own, so the memory of the population is split between the workers. The
+partitions are cut so each holds about the same number of contacts. Each synchronous tick the workers send the changes of their boundary agents
+to the parent process, which routes them to the partitions holding ghost copies of
+those agents and adds up the daily counts, all over Unix socket pairs. Because draws
+are keyed by global agent id and day, a seed gives exactly the counts of a single
+engine running the whole snapshot in tick_mode::synchronous, whatever the number of
+processes.
+*/
+class partitioned_run
+{
+private:
+	// scenario every worker sets up
+	std::string snapshot_path;
+	spread_parameters parameters;
+	std::vector<intervention> interventions;
+	std::uint64_t seed;
+	size_t num_sick;
+
+	// number of worker processes, and threads each of them ticks with
+	size_t processes;
+	size_t threads;
+
+public:
+
+	// default constructor makes a run of 2 single-threaded processes with a seed from
+	// std::random_device
+	partitioned_run();
+
+	/**
+	Sets the network snapshot every worker loads, written by spread_engine::save_network
+	@param path is the snapshot file
+	*/
+	void set_snapshot(const std::string& path);
+
+	/**
+	Sets the parameters every worker uses
+	@param new_parameters is the parameter set, with as many groups as the snapshot
+	*/
+	void set_parameters(const spread_parameters& new_parameters);
+
+	/**
+	Sets the interventions every worker applies, see spread_engine::set_interventions
+	@param timeline holds the interventions, checked by the workers against the parameters
+	*/
+	void set_interventions(const std::vector<intervention>& timeline);
+
+	/**
+	Sets the seed of the run
+	@param new_seed is the seed every worker uses
+	*/
+	void set_seed(const std::uint64_t new_seed);
+
+	/**
+	Sets the number of people infected on day 0
+	@param sick is the initial sick population
+	*/
+	void set_initial_sick(const size_t sick);
+
+	/**
+	Sets how many worker processes the population is split over
+	@param count is the number of processes, at least 1
+	*/
+	void set_processes(const size_t count);
+
+	/**
+	Sets how many threads each worker ticks with, results do not depend on it
+	@param count is the number of threads per process
+	*/
+	void set_threads(const size_t count);
+
+	/**
+	@brief Starts the workers and runs until nobody is infected or days have passed
+	@param days is the horizon, 0 runs until the epidemic is over
+	@param report is called in the parent with the day and the counts of every group
+	summed over the partitions, counts[group * 3 + state] for the states susceptible,
+	infected and removed, from day 0 on
+	@throws std::runtime_error if the platform has no fork, a worker cannot be started,
+	or a worker fails
+	*/
+	void run(const size_t days, const std::function<void(size_t, const std::vector<size_t>&)>& report);
+};
+
+#endif // ! PARTITIONED_RUN_H
@@ -0,0 +1,108 @@
+#ifndef REMOVAL_CALENDAR_H
+#define REMOVAL_CALENDAR_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+/**
+@class removal_calendar
+@brief The removal_calendar class is a bucket (calendar) queue holding every infected
+agent under the day they will be removed.
+
+Buckets form a ring indexed by day modulo its size, so filing an agent and collecting a
+day's removals are both O(1) per agent. Days further ahead than the ring covers make it
+double in size, which only happens a handful of times for geometric delays.
+*/
+class removal_calendar
+{
+public:
+	using agent_id = std::uint32_t;
+
+private:
+	// buckets[day & (buckets.size() - 1)] holds the agents removed on day
+	std::vector<std::vector<agent_id>> buckets;
+	// first day whose bucket has not been collected yet
+	size_t today;
+	// number of agents filed in all buckets
+	size_t pending;
+
+	// doubles the ring until it covers day, re-filing every bucket
+	void grow(const size_t day) {
+		size_t new_size = buckets.size();
+		while (day - today >= new_size) { new_size *= 2; }
+
+		std::vector<std::vector<agent_id>> grown(new_size);
+		for (size_t i = 0; i < buckets.size(); ++i) {
+			// the bucket at i holds the only day in [today, today + size) congruent to i
+			const size_t bucket_day = today + ((i - today) & (buckets.size() - 1));
+			grown[bucket_day & (new_size - 1)].swap(buckets[i]);
+		}
+		buckets.swap(grown);
+	}
+
+public:
+
+	// default constructor starts an empty calendar on day 0
+	removal_calendar() : buckets(64), today(0), pending(0) {}
+
+	/**
+	Empties the calendar
+	@param start_day is the first day that will be collected
+	*/
+	void reset(const size_t start_day) {
+		std::vector<std::vector<agent_id>>(64).swap(buckets);
+		today = start_day;
+		pending = 0;
+	}
+
+	/**
+	Files an agent under the day of their removal
+	@param person is the infected agent
+	@param day is their removal day, no earlier than the first uncollected day
+	*/
+	void schedule(const agent_id person, const size_t day) {
+		if (day - today >= buckets.size()) { grow(day); }
+		buckets[day & (buckets.size() - 1)].push_back(person);
+		++pending;
+	}
+
+	/**
+	Getter for the agents removed on the first uncollected day
+	@return is the bucket of that day, it may still grow while being read
+	*/
+	std::vector<agent_id>& due() { return buckets[today & (buckets.size() - 1)]; }
+
+	/**
+	@brief Empties the first uncollected day's bucket and moves on to the next day
+	*/
+	void advance() {
+		std::vector<agent_id>& done = due();
+		pending -= done.size();
+		done.clear();
+		++today;
+	}
+
+	/**
+	Getter for the first uncollected day
+	@return is a size_t corresponding to that day
+	*/
+	size_t first_day() const { return today; }
+
+	//size function, which counts agents in all buckets
+	size_t size() const { return pending; }
+
+	/**
+	Calls visit(agent) for every filed agent, in no particular order
+	@param visit is called once per agent
+	*/
+	template<typename Visit>
+	void for_each(const Visit& visit) const {
+		for (const std::vector<agent_id>& bucket : buckets) {
+			for (agent_id person : bucket) { visit(person); }
+		}
+	}
+};
+
+#endif // ! REMOVAL_CALENDAR_H
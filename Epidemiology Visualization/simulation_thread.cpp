@@ -0,0 +1,81 @@
+#include "simulation_thread.h"
+#include <chrono>
+
+simulation_thread::simulation_thread(spread_engine& sim_engine) :
+	engine(sim_engine), speed(sim_speed::one_per_second), stopping(false) {}
+
+simulation_thread::~simulation_thread() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	if (runner.joinable()) { runner.join(); }
+}
+
+void simulation_thread::start(const size_t num_normal, const size_t num_moron, const size_t num_sick) {
+	runner = std::thread(&simulation_thread::run, this, num_normal, num_moron, num_sick);
+}
+
+void simulation_thread::set_speed(const sim_speed new_speed) {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		speed = new_speed;
+	}
+	wake.notify_all();
+}
+
+simulation_thread::sim_speed simulation_thread::get_speed() const { return speed; }
+
+const simulation_thread::snapshot& simulation_thread::latest() { return counts.read(); }
+
+void simulation_thread::publish() {
+	snapshot today;
+	today.ready = true;
+	today.day = engine.get_days_elapsed();
+	today.susceptible_normal = engine.get_susceptible_normal();
+	today.infected_normal = engine.get_infected_normal();
+	today.removed_normal = engine.get_removed_normal();
+	today.susceptible_moron = engine.get_susceptible_moron();
+	today.infected_moron = engine.get_infected_moron();
+	today.removed_moron = engine.get_removed_moron();
+	counts.publish(today);
+}
+
+void simulation_thread::run(const size_t num_normal, const size_t num_moron, const size_t num_sick) {
+
+	// set up the population here too, it is the slowest step for large populations
+	engine.set_initial_populations(num_normal, num_moron, num_sick);
+	engine.init_spread_network();
+	engine.populate_spread_network();
+	engine.randomly_infect_healthy();
+	publish();
+
+	using clock = std::chrono::steady_clock;
+	clock::time_point next_tick = clock::now() + std::chrono::seconds(1);
+
+	std::unique_lock<std::mutex> guard(lock);
+	while (!stopping) {
+		const sim_speed current = speed;
+		const bool epidemic_over = engine.get_total_infected() == 0;
+
+		// nothing to do while paused or once nobody is infected, until told otherwise
+		if (current == sim_speed::paused || epidemic_over) {
+			wake.wait(guard, [&] { return stopping || speed != current; });
+			next_tick = clock::now() + std::chrono::seconds(1);
+			continue;
+		}
+		// at one day per second, sleep until the next tick is due unless woken early
+		if (current == sim_speed::one_per_second && clock::now() < next_tick) {
+			wake.wait_until(guard, next_tick, [&] { return stopping || speed != current; });
+			continue;
+		}
+
+		// tick without holding the lock, so set_speed never waits on a tick
+		next_tick = clock::now() + std::chrono::seconds(1);
+		guard.unlock();
+		engine.tick();
+		publish();
+		guard.lock();
+	}
+}
@@ -0,0 +1,104 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+#include "spread_engine.h"
+#include "triple_buffer.h"
+
+
+/**
+@class simulation_thread
+@brief The simulation_thread class runs a spread_engine on its own thread, so slow setup
+or slow ticks never hold up drawing or input, and publishes the counts of each day to
+the render thread through a triple_buffer.
+*/
+class simulation_thread
+{
+public:
+
+	/**
+	@enum sim_speed
+	@brief How fast days are simulated: not at all, one per wall-clock second, or as
+	fast as the engine can tick
+	*/
+	enum class sim_speed { paused, one_per_second, max_speed };
+
+	/**
+	@struct snapshot
+	@brief Day number and S, I and R counts of both groups at the end of one day
+	*/
+	struct snapshot {
+		// false until the population has been set up
+		bool ready = false;
+		size_t day = 0;
+		size_t susceptible_normal = 0, infected_normal = 0, removed_normal = 0;
+		size_t susceptible_moron = 0, infected_moron = 0, removed_moron = 0;
+	};
+
+private:
+	// the engine, only touched by the simulation thread once start is called
+	spread_engine& engine;
+	std::thread runner;
+
+	// guards waking the simulation thread, the fields below are atomics so the render
+	// thread can change them without waiting on a tick
+	std::mutex lock;
+	std::condition_variable wake;
+	std::atomic<sim_speed> speed;
+	std::atomic<bool> stopping;
+
+	// newest counts for the render thread
+	triple_buffer<snapshot> counts;
+
+	// body of the simulation thread: set up, then tick at the chosen speed
+	void run(const size_t num_normal, const size_t num_moron, const size_t num_sick);
+	// copies the engine's counts into the triple buffer
+	void publish();
+
+public:
+
+	/**
+	Wraps an engine, without starting anything yet
+	@param sim_engine is the engine to run, it must outlive this object and must not be
+	used by anyone else once start is called
+	*/
+	explicit simulation_thread(spread_engine& sim_engine);
+	// stops the simulation thread and waits for the tick in progress to finish
+	~simulation_thread();
+
+	simulation_thread(const simulation_thread&) = delete;
+	simulation_thread& operator=(const simulation_thread&) = delete;
+
+	/**
+	@brief Starts the simulation thread, which sets up the population and then ticks at
+	the current speed, one day per second unless set_speed was called
+	@param num_normal is the initial normal population
+	@param num_moron is the initial moron population
+	@param num_sick is the initial sick population
+	*/
+	void start(const size_t num_normal, const size_t num_moron, const size_t num_sick);
+
+	/**
+	Changes how fast days are simulated, takes effect straight away
+	@param new_speed is the sim_speed to use
+	*/
+	void set_speed(const sim_speed new_speed);
+
+	/**
+	Getter for the current speed
+	@return is the sim_speed in use
+	*/
+	sim_speed get_speed() const;
+
+	/**
+	Gets the newest published counts without waiting, render thread only
+	@return is a const snapshot& valid until the next call to latest
+	*/
+	const snapshot& latest();
+};
+
+#endif // ! SIMULATION_THREAD_H
@@ -1,21 +1,102 @@
 #include "spread_engine.h"
 #include <cmath>
+#include <stdexcept>
+#include <fstream>
+#include <cstring>
+#include <numeric>
+#include <bitset>
+#include <unordered_map>
+#include "network_snapshot.h"
+#include "network_generators.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// kinds of per-agent draws made in a tick, each gets its own stream
+enum draw_purpose : std::uint32_t { infection_draw = 0, removal_draw = 1 };
+
+// mixed into the seed for the hash that decides which contacts an intervention closes
+static constexpr std::uint64_t contact_hash_key = 0x636f6e7461637473ull;
+
+// probability scaled to a 32 bit threshold, a raw word is below it with that probability
+static std::uint32_t probability_threshold(const double probability) {
+	const double scaled = std::ldexp(probability, 32);
+	return scaled >= 4294967295.0 ? 0xffffffffu : static_cast<std::uint32_t>(scaled);
+}
+
+// maps a snapshot written by save_network and checks every position in its header,
+// groups is the number of groups the parameters have
+static std::shared_ptr<const mapped_file> map_snapshot(const std::string& path, const size_t groups, snapshot_header& header) {
+	std::shared_ptr<const mapped_file> file = std::make_shared<const mapped_file>(path);
+
+	// check the header before trusting any of the positions in it
+	if (file->size() < sizeof(header)) {
+		throw std::runtime_error(path + " is not a network snapshot!");
+	}
+	std::memcpy(&header, file->data(), sizeof(header));
+	if (std::memcmp(header.magic, snapshot_magic, sizeof(header.magic)) != 0) {
+		throw std::runtime_error(path + " is not a network snapshot!");
+	}
+	if ((header.version != snapshot_version && header.version != snapshot_two_group_version) ||
+		header.byte_order != snapshot_byte_order) {
+		throw std::runtime_error(path + " was written by another version or byte order!");
+	}
+	// version 1 files always hold the two default groups
+	const size_t stored_groups = header.version == snapshot_two_group_version ? 2 : static_cast<size_t>(header.group_count);
+	if (stored_groups != groups) {
+		throw std::runtime_error(path + " has " + std::to_string(stored_groups) + " groups, the parameters have " +
+			std::to_string(groups) + "!");
+	}
+	const snapshot_header expected = make_snapshot_header(header.population, header.group_count, header.edge_slots);
+	if (header.population >= std::numeric_limits<std::uint32_t>::max() ||
+		header.offsets_at != expected.offsets_at || header.neighbors_at != expected.neighbors_at ||
+		header.groups_at != expected.groups_at || file->size() < header.groups_at + header.population) {
+		throw std::runtime_error(path + " is truncated or damaged!");
+	}
+
+	const contact_graph::edge_index* offsets =
+		reinterpret_cast<const contact_graph::edge_index*>(file->data() + header.offsets_at);
+	if (offsets[0] != 0 || offsets[header.population] != header.edge_slots) {
+		throw std::runtime_error(path + " is truncated or damaged!");
+	}
+	return file;
+}
+
+// first agent of each of parts contiguous ranges holding about the same number of
+// contacts, followed by the population
+static std::vector<std::uint32_t> cut_by_contacts(const contact_graph::edge_index* offsets, const size_t population,
+	const size_t parts) {
+	std::vector<std::uint32_t> starts(1, 0);
+	for (size_t part = 1; part < parts; ++part) {
+		// first agent whose contacts start at or past this part's share
+		const contact_graph::edge_index share = offsets[population] * part / parts;
+		starts.push_back(static_cast<std::uint32_t>(std::lower_bound(offsets, offsets + population, share) - offsets));
+	}
+	starts.push_back(static_cast<std::uint32_t>(population));
+	return starts;
+}
+
 
 // default constructor inits all size_t values to 0
 spread_engine::spread_engine() : 
-	initial_sick(0), elapsed_days(0), 
-	total_normal(0), susceptible_normal(0), infected_normal(0), removed_normal(0),
-	total_moron(0),  susceptible_moron(0),  infected_moron(0),  removed_moron(0) {}
+	initial_sick(0), elapsed_days(0), group_sizes(parameters.groups.size(), 0), agent_group(nullptr), counter_groups(0),
+	counter_stride(0), group_counts(3 * parameters.groups.size(), 0), compact_compartments(false), sorted_at_risk(0),
+	seed((std::uint64_t(std::random_device{}()) << 32) | std::random_device{}()),
+	mode(tick_mode::immediate), direction(propagation::automatic), graph_cache_bytes(std::numeric_limits<size_t>::max()),
+	threshold_stride(0), removal_log_survival(0), next_intervention(0), events_scheduled(false), current_time(0),
+	class_population(false), owned_last(0), global_base(0), whole_population(0), widest_network(0), partition_index(0),
+	halo(nullptr) {
+	network = std::make_shared<const contact_graph>();
+	immediate_rng = sequential_rng::substream(seed, immediate_substream);
+	event_rng = sequential_rng::substream(seed, event_substream);
+}
 
-// default destructor
+// default destructor, every per-agent vector frees itself
 spread_engine::~spread_engine() = default;
 
-template<typename Numeric, typename Generator>
+template<typename Numeric>
 Numeric spread_engine::random(Numeric from, Numeric to)
 {
-	// inits thread_local generator via random header
-	thread_local static Generator gen(std::random_device{}());
-
 	// inits distribution type based on Numeric type
 	using dist_type = typename std::conditional<
 		std::is_integral<Numeric>::value,
@@ -27,326 +108,1796 @@ Numeric spread_engine::random(Numeric from, Numeric to)
 	thread_local static dist_type dist;
 
 	// returns Numeric from dist 
-	return dist(gen, typename dist_type::param_type{ from,to });
+	return dist(immediate_rng, typename dist_type::param_type{ from,to });
 }
 
 
 void spread_engine::set_initial_populations(const size_t num_normal, const size_t num_moron, const size_t num_sick) {
-	//sets private size_t vals based on user input
-	total_normal = num_normal;
-	total_moron = num_moron;
+	//sets private size_t vals based on user input, normal people are group 0 and morons group 1
+	set_group_populations({ num_normal, num_moron }, num_sick);
+}
+
+void spread_engine::set_group_populations(const std::vector<size_t>& sizes, const size_t num_sick) {
+	group_sizes = sizes;
 	initial_sick = num_sick;
 }
 
+void spread_engine::set_seed(const std::uint64_t new_seed) {
+	seed = new_seed;
+	immediate_rng = sequential_rng::substream(seed, immediate_substream);
+	event_rng = sequential_rng::substream(seed, event_substream);
+}
+std::uint64_t spread_engine::get_seed() const { return seed; }
+
+void spread_engine::set_threads(const size_t threads) { workers.resize(threads > 0 ? threads : 1); }
+void spread_engine::set_graph_cache(const size_t bytes) { graph_cache_bytes = bytes; }
+void spread_engine::set_tick_mode(const tick_mode new_mode) {
+	// a partition's counters only cover its own agents, which only the synchronous sweeps respect
+	if (halo != nullptr && new_mode != tick_mode::synchronous) {
+		throw std::logic_error("Partitioned engines can only tick synchronously!");
+	}
+	mode = new_mode;
+}
+void spread_engine::set_propagation(const propagation new_direction) { direction = new_direction; }
+void spread_engine::set_compact_compartments(const bool compact) { compact_compartments = compact; }
+
+void spread_engine::set_parameters(const spread_parameters& new_parameters) {
+	const size_t groups = new_parameters.groups.size();
+	// group ids are stored in one byte per agent
+	if (groups == 0 || groups > std::numeric_limits<std::uint8_t>::max()) {
+		throw std::length_error("There must be between 1 and 255 groups!");
+	}
+	if (!(new_parameters.beta >= 0.0) || !(new_parameters.gamma >= 0.0 && new_parameters.gamma <= 1.0)) {
+		throw std::logic_error("Rates must be non-negative and gamma at most 1!");
+	}
+	for (const group_parameters& group : new_parameters.groups) {
+		if (group.contacts > std::numeric_limits<contact_count>::max()) {
+			throw std::length_error("Contact numbers are too large for the ill contact counters!");
+		}
+		if (!(group.mask >= 0.0)) {
+			throw std::logic_error("Mask factors must be non-negative!");
+		}
+	}
+	const network_topology& topology = new_parameters.topology;
+	if (topology.kind == network_topology::model::small_world &&
+		2 * topology.ring_neighbors > std::numeric_limits<contact_count>::max()) {
+		throw std::length_error("Contact numbers are too large for the ill contact counters!");
+	}
+	if (!(topology.rewiring >= 0.0 && topology.rewiring <= 1.0)) {
+		throw std::logic_error("The rewiring probability must be between 0 and 1!");
+	}
+	if (topology.household_size == 0 || topology.workplace_size == 0) {
+		throw std::logic_error("Households and workplaces must have at least one member!");
+	}
+	if (!new_parameters.mixing.empty() && new_parameters.mixing.size() != groups * groups) {
+		throw std::logic_error("The mixing matrix must have one entry for every pair of groups!");
+	}
+	for (const double weight : new_parameters.mixing) {
+		if (!(weight >= 0.0)) {
+			throw std::logic_error("Mixing weights must be non-negative!");
+		}
+	}
+	// the per-agent arrays are laid out for the current groups
+	if (get_population() > 0 && groups != counter_groups) {
+		throw std::logic_error("The number of groups cannot change once a population is set up!");
+	}
+	parameters = new_parameters;
+
+	// pending events were drawn from the old rates, every hazard is memoryless so they
+	// can simply be redrawn from the new ones at the next tick
+	if (events_scheduled) { unschedule_events(); }
+	// once a network exists the tables follow the new rates straight away
+	if (get_population() > 0) { build_thresholds(); }
+}
+const spread_parameters& spread_engine::get_parameters() const { return parameters; }
+
+void spread_engine::check_intervention(const intervention& change) const {
+	const size_t groups = parameters.groups.size();
+	if (!change.contact_share.empty() && change.contact_share.size() != groups * groups) {
+		throw std::logic_error("An intervention's contact shares must have one entry for every pair of groups!");
+	}
+	for (size_t g = 0; g < groups && !change.contact_share.empty(); ++g) {
+		for (size_t h = 0; h < groups; ++h) {
+			const double share = change.contact_share[g * groups + h];
+			if (!(share >= 0.0 && share <= 1.0)) {
+				throw std::logic_error("Contact shares must be between 0 and 1!");
+			}
+			// a contact is one draw seen from both ends, so it is open for both or neither
+			if (share != change.contact_share[h * groups + g]) {
+				throw std::logic_error("Contact shares must be the same both ways between two groups!");
+			}
+		}
+	}
+	if (!change.mask_scale.empty() && change.mask_scale.size() != groups) {
+		throw std::logic_error("An intervention must scale the mask of every group or of none!");
+	}
+	for (const double scale : change.mask_scale) {
+		if (!(scale >= 0.0)) {
+			throw std::logic_error("Mask scales must be non-negative!");
+		}
+	}
+}
+
+void spread_engine::set_interventions(const std::vector<intervention>& timeline) {
+	for (const intervention& change : timeline) { check_intervention(change); }
+	interventions = timeline;
+	std::stable_sort(interventions.begin(), interventions.end(),
+		[](const intervention& a, const intervention& b) { return a.day < b.day; });
+	next_intervention = 0;
+}
+
+void spread_engine::apply_intervention(const intervention& change) {
+	check_intervention(change);
+
+	// an empty field keeps what is in force, and all 1s are stored as empty so that
+	// runs without an intervention in force take the unmasked paths
+	auto all_ones = [](const std::vector<double>& values) {
+		return std::all_of(values.begin(), values.end(), [](const double value) { return value == 1.0; });
+	};
+	std::vector<double> shares = change.contact_share.empty() ? contact_share : change.contact_share;
+	if (all_ones(shares)) { shares.clear(); }
+	std::vector<double> scales = change.mask_scale.empty() ? mask_scale : change.mask_scale;
+	if (all_ones(scales)) { scales.clear(); }
+
+	if (class_population && !shares.empty()) {
+		throw std::logic_error("The tau_leap mode has no contacts to close!");
+	}
+	const bool shares_changed = shares != contact_share;
+	const bool scales_changed = scales != mask_scale;
+	if (!shares_changed && !scales_changed) { return; }
+
+	// pending events were drawn from the old hazards, they are memoryless so they can
+	// simply be redrawn from the new ones at the next tick
+	if (events_scheduled) { unschedule_events(); }
+	contact_share.swap(shares);
+	mask_scale.swap(scales);
+	if (scales_changed && get_population() > 0) { build_thresholds(); }
+	if (shares_changed) { update_closed_contacts(); }
+}
+
+void spread_engine::apply_due_interventions() {
+	while (next_intervention < interventions.size() && interventions[next_intervention].day <= elapsed_days) {
+		apply_intervention(interventions[next_intervention++]);
+	}
+}
+
+void spread_engine::update_closed_contacts() {
+
+	// without a network there is nothing to close yet, populate_spread_network calls this again
+	if (class_population || network->size() != get_population() || get_population() == 0) {
+		std::vector<std::uint64_t>().swap(closed_contacts);
+		return;
+	}
+
+	const contact_graph::edge_index* offsets = network->offset_array();
+	const agent_id* neighbors = network->neighbor_array();
+	const size_t groups = counter_groups;
+
+	// a partition draws its ghosts' slots as well, the halo reads them
+	const size_t total_people = get_population();
+	const size_t last_slot = network->edge_slots();
+
+	next_closed.clear();
+	if (!contact_share.empty()) {
+		// a contact between groups g and h stays open if its word is below their share
+		// scaled to 2^32, a share of 1 keeps every word
+		std::vector<std::uint64_t> kept(groups * groups);
+		for (size_t pair = 0; pair < kept.size(); ++pair) {
+			kept[pair] = static_cast<std::uint64_t>(std::ldexp(contact_share[pair], 32));
+		}
+		// with one share for everyone the contacts' groups are not needed, which saves a
+		// lookup all over memory per slot
+		const bool uniform = std::all_of(kept.begin(), kept.end(), [&](const std::uint64_t k) { return k == kept[0]; });
+		next_closed.assign((network->edge_slots() + 63) / 64, 0);
+
+		// every slot is hashed, so the word is a splitmix64 hash of the two ids rather than
+		// a Philox block, keyed by the seed
+		std::uint64_t key_state = seed ^ contact_hash_key;
+		const std::uint64_t key = splitmix64(key_state);
+
+		// chunks of slots start on multiples of closing_chunk, so each writes its own words
+		const size_t chunks = (last_slot + closing_chunk - 1) / closing_chunk;
+		workers.run(chunks, [&](const size_t task) {
+			const size_t first = task * closing_chunk;
+			const size_t last = std::min(last_slot, (task + 1) * closing_chunk);
+			// the agent whose contacts hold the chunk's first slot
+			agent_id person = static_cast<agent_id>(
+				std::upper_bound(offsets, offsets + total_people + 1, first) - offsets - 1);
+
+			// the contacts' groups are gathered a batch at a time ahead of the hashing, so
+			// their cache misses overlap
+			static constexpr size_t batch_size = 256;
+			std::uint8_t contact_groups[batch_size] = {};
+			for (size_t batch = first; batch < last; batch += batch_size) {
+				const size_t batch_last = std::min(last, batch + batch_size);
+				if (!uniform) {
+					for (size_t slot = batch; slot < batch_last; ++slot) { contact_groups[slot - batch] = agent_group[neighbors[slot]]; }
+				}
+				for (size_t slot = batch; slot < batch_last; ++slot) {
+					while (offsets[person + 1] <= slot) { ++person; }
+					// both ends of a contact hash the same global ids, lower first, and the word
+					// does not depend on the share, so lower shares close more of the same contacts
+					const agent_id contact = neighbors[slot];
+					const agent_id person_id = global_id(person);
+					const agent_id contact_id = global_id(contact);
+					std::uint64_t state = key ^ (std::uint64_t(std::min(person_id, contact_id)) << 32 | std::max(person_id, contact_id));
+					const std::uint64_t word = splitmix64(state) >> 32;
+					const size_t pair = uniform ? 0 : agent_group[person] * groups + contact_groups[slot - batch];
+					if (word >= kept[pair]) {
+						next_closed[slot >> 6] |= std::uint64_t(1) << (slot & 63);
+					}
+				}
+			}
+		});
+	}
+
+	// whether a contact is ill is looked up for every contact that closed or reopened,
+	// the bitmap keeps those lookups in cache
+	build_infected_bits();
+
+	// every owned susceptible person only writes their own counters and frontier flag,
+	// a contact that closed while ill is one ill contact less and one that reopened one more
+	const std::uint64_t* before = closed_contacts.empty() ? nullptr : closed_contacts.data();
+	const std::uint64_t* after = next_closed.empty() ? nullptr : next_closed.data();
+	auto closed_in = [](const std::uint64_t* bits, const size_t slot) {
+		return bits != nullptr && (bits[slot >> 6] >> (slot & 63) & 1);
+	};
+	const size_t owned = static_cast<size_t>(owned_last);
+	const size_t chunks = (owned + chunk_size - 1) / chunk_size;
+	if (chunk_at_risk.size() < chunks) { chunk_at_risk.resize(chunks); }
+	workers.run(chunks, [&](const size_t chunk) {
+		std::vector<agent_id>& joined = chunk_at_risk[chunk];
+		joined.clear();
+		const size_t first = chunk * chunk_size;
+		const size_t last = std::min(owned, first + chunk_size);
+		for (size_t i = first; i < last; ++i) {
+			const agent_id person = static_cast<agent_id>(i);
+			if (health[person] != susceptible) { continue; }
+			bool gained = false;
+			for (size_t slot = static_cast<size_t>(offsets[person]); slot < static_cast<size_t>(offsets[person + 1]); ++slot) {
+				const bool was_closed = closed_in(before, slot);
+				const agent_id contact = neighbors[slot];
+				if (was_closed == closed_in(after, slot) || !(infected_bits[contact >> 6] >> (contact & 63) & 1)) { continue; }
+				contact_count& counter = ill_counters(agent_group[contact])[person];
+				counter = static_cast<contact_count>(was_closed ? counter + 1 : counter - 1);
+				gained = gained || was_closed;
+			}
+			if (gained && !listed_at_risk(person)) {
+				set_listed_at_risk(person, true);
+				joined.push_back(person);
+			}
+		}
+	});
+	for (size_t chunk = 0; chunk < chunks; ++chunk) {
+		at_risk_people.insert(at_risk_people.end(), chunk_at_risk[chunk].begin(), chunk_at_risk[chunk].end());
+	}
+	closed_contacts.swap(next_closed);
+
+	// people whose ill contacts all closed leave the frontier, newcomers are merged in
+	prune_compartments();
+}
+
 //standard getters that return private member vars
 const size_t spread_engine::get_days_elapsed() const { return elapsed_days; }
+const tick_profile& spread_engine::get_profile() const { return profile; }
+void spread_engine::clear_profile() { profile.clear(); }
+const size_t spread_engine::get_population() const { return class_population ? classes.population() : health.size(); }
+const size_t spread_engine::get_group_count() const { return parameters.groups.size(); }
 
-const size_t spread_engine::get_susceptible_normal() const { return susceptible_normal; }
-const size_t spread_engine::get_infected_normal() const { return infected_normal; }
-const size_t spread_engine::get_removed_normal() const { return removed_normal; }
+// groups without a population yet count as empty
+const size_t spread_engine::get_susceptible(const size_t group) const {
+	return group < counter_groups ? group_counts[group * 3 + susceptible] : 0;
+}
+const size_t spread_engine::get_infected(const size_t group) const {
+	return group < counter_groups ? group_counts[group * 3 + infected] : 0;
+}
+const size_t spread_engine::get_removed(const size_t group) const {
+	return group < counter_groups ? group_counts[group * 3 + removed] : 0;
+}
+
+size_t spread_engine::total_in(const health_state state) const {
+	size_t total = 0;
+	for (size_t group = 0; group < counter_groups; ++group) { total += group_counts[group * 3 + state]; }
+	return total;
+}
+const size_t spread_engine::get_total_susceptible() const { return total_in(susceptible); }
+const size_t spread_engine::get_total_infected() const { return total_in(infected); }
+const size_t spread_engine::get_total_removed() const { return total_in(removed); }
 
-const size_t spread_engine::get_susceptible_moron() const { return susceptible_moron; }
-const size_t spread_engine::get_infected_moron() const { return infected_moron; }
-const size_t spread_engine::get_removed_moron() const { return removed_moron; }
+const size_t spread_engine::get_susceptible_normal() const { return get_susceptible(0); }
+const size_t spread_engine::get_infected_normal() const { return get_infected(0); }
+const size_t spread_engine::get_removed_normal() const { return get_removed(0); }
 
-/**
-@struct person
-@brief The person struct stores a set of variables, as well as
-a network vector, for each person in the simulation.
-*/
-struct spread_engine::person {
+const size_t spread_engine::get_susceptible_moron() const { return get_susceptible(1); }
+const size_t spread_engine::get_infected_moron() const { return get_infected(1); }
+const size_t spread_engine::get_removed_moron() const { return get_removed(1); }
 
-	// bool for determining if person is a moron
-	bool is_moron = false;
-	// network size is fixed at 9 or 20 based on is_moron, set later
-	size_t network_size = 0;
+void spread_engine::init_spread_network() {
+	const size_t groups = parameters.groups.size();
+	if (group_sizes.size() != groups) {
+		throw std::logic_error("There must be one population size for every group!");
+	}
+	// the approximate mode only covers the network the class model describes
+	if (mode == tick_mode::tau_leap && parameters.topology.kind != network_topology::model::configuration) {
+		throw std::logic_error("The tau_leap mode only follows configuration networks!");
+	}
+	// total population, every agent needs its own agent_id (classes need none)
+	size_t total_people = 0;
+	for (const size_t size : group_sizes) {
+		if (mode != tick_mode::tau_leap && size >= no_agent - total_people) {
+			throw std::length_error("Population is too large for 32 bit agent ids!");
+		}
+		total_people += size;
+	}
 
-	// size_ts to track number of morons and normals in network
-	size_t ill_normal_contacts = 0;
-	size_t ill_moron_contacts = 0;
+	// swap with empty vectors so a previous run's memory is actually handed back
+	group_storage.reset();
+	agent_group = nullptr;
+	std::vector<contact_count>().swap(ill_contacts);
+	std::vector<std::uint8_t>().swap(health);
+	network = std::make_shared<const contact_graph>();
+	std::vector<agent_id>().swap(need_contacts);
+	susceptible_people.reset(0);
+	infected_people.reset(0);
+	std::vector<agent_id>().swap(at_risk_people);
+	sorted_at_risk = 0;
 
-	// network vector based on configuration network 
-	std::vector<person*> network;
-};
+	// a new population is simulated whole until own_agents says otherwise
+	owned_last = static_cast<agent_id>(total_people);
+	global_base = 0;
+	whole_population = total_people;
+	widest_network = 0;
+	partition_starts.clear();
+	partition_index = 0;
+	halo = nullptr;
+	std::vector<agent_id>().swap(ghost_ids);
+	std::vector<agent_id>().swap(boundary_ids);
+	std::vector<size_t>().swap(boundary_offsets);
+	std::vector<std::uint32_t>().swap(boundary_partitions);
 
-void spread_engine::init_spread_network() {
-	// define temp size_t to make sure we get enough morons (set in user input)
-	size_t current_morons = 0;
-	
-	// generate people acc to number of normal and number of moron
-	for (size_t i = 0; i < (total_normal + total_moron); ++i) {
+	// reset tracking variables left over from a previous run
+	elapsed_days = 0;
+	current_time = 0;
+	events_scheduled = false;
+	events.reset(0);
+	removals.reset(0);
+	// event delays get their own stream of the run's seed, drawn from for the whole run
+	// so every rescheduling draws fresh delays
+	event_rng = sequential_rng::substream(seed, event_substream);
 
-		// init person 
-		person* new_person = new person;
+	// every run starts with all contacts open and the timeline from its first intervention
+	contact_share.clear();
+	mask_scale.clear();
+	std::vector<std::uint64_t>().swap(closed_contacts);
+	next_intervention = 0;
 
-		// if we do not yet have enough morons
-		if (current_morons < total_moron) {
-			// make new_person a moron
-			new_person->is_moron = true;
-			++current_morons;
-		} // else, new_person is a normal by default
+	// before we initially infect, everyone in every group is susceptible
+	group_counts.assign(3 * groups, 0);
+	for (size_t group = 0; group < groups; ++group) {
+		group_counts[group * 3 + susceptible] = group_sizes[group];
+	}
 
-		// push back new_person to susceptible people and all people
-		all_people.push_back(new_person);
-		susceptible_people.push_back(new_person);
+	// tau_leap keeps class counts in place of every per-agent vector below
+	class_population = false;
+	if (mode == tick_mode::tau_leap) {
+		classes.reset(parameters, group_sizes, sequential_rng::substream(seed, class_substream));
+		class_population = true;
+		counter_groups = groups;
+		counter_stride = 0;
+		std::vector<std::uint64_t>().swap(in_frontier);
+		return;
+	}
+	classes = contact_classes();
 
-		// push back new_person need_contacts for network generation
-		need_contacts.push_back(new_person);
+	// agents are numbered group by group, group 0 first
+	// (populate_spread_network shuffles need_contacts, so this order does not leak into networks)
+	std::vector<std::uint8_t> numbered;
+	numbered.reserve(total_people + kernel_padding);
+	for (size_t group = 0; group < groups; ++group) {
+		numbered.insert(numbered.end(), group_sizes[group], static_cast<std::uint8_t>(group));
 	}
+	numbered.insert(numbered.end(), kernel_padding, 0);
+	assign_groups(std::move(numbered));
+
+	// nobody starts with ill contacts or a network
+	counter_groups = groups;
+	counter_stride = total_people + kernel_padding;
+	ill_contacts.assign(groups * counter_stride, 0);
 
-	// before we initially infect, all normal and morons are susceptible
-	susceptible_normal = total_normal;
-	susceptible_moron = total_moron;
+	// everyone starts healthy, so nobody is at risk yet
+	health.assign(total_people, susceptible);
+	in_frontier.assign((total_people + 63) / 64, 0);
+
+	// everyone starts susceptible and in need of contacts
+	need_contacts.resize(total_people);
+	std::iota(need_contacts.begin(), need_contacts.end(), agent_id(0));
+	if (!compact_compartments) {
+		susceptible_people.reset(total_people);
+		susceptible_people.fill(total_people);
+		infected_people.reset(total_people);
+	}
 
 }
 
+void spread_engine::generate_topology() {
+	const size_t total_people = get_population();
+	std::shared_ptr<contact_graph> built = std::make_shared<contact_graph>();
+	switch (parameters.topology.kind) {
+	case network_topology::model::small_world:
+		generate_small_world(*built, total_people, parameters.topology, seed, workers);
+		break;
+	case network_topology::model::preferential_attachment:
+		generate_preferential_attachment(*built, total_people, parameters.topology, seed, workers);
+		break;
+	default:
+		generate_households(*built, total_people, parameters.topology, seed, workers);
+		break;
+	}
+
+	// preferential attachment hubs grow with the population, past some size they no
+	// longer fit the counters
+	if (built->max_degree() > std::numeric_limits<contact_count>::max()) {
+		throw std::length_error("Contact numbers are too large for the ill contact counters!");
+	}
+
+	// nobody needs stubs, the generators place every contact themselves
+	need_contacts.clear();
+	need_contacts.shrink_to_fit();
+	network = std::move(built);
+	build_thresholds();
+	if (!contact_share.empty()) { update_closed_contacts(); }
+}
+
 void spread_engine::populate_spread_network() {
-	
-	std::random_device rd;
-	std::mt19937 g(rd());
-	// to ensure randomness in assignment we shuffle need_contacts
-	// (otherwise morons always get assigned first)
-	std::shuffle(need_contacts.begin(), need_contacts.end(), g);
 
-	// while networks are not filled
-	while (need_contacts.size() > 1) {
+	// contact classes stand in for the network
+	if (class_population) { return; }
 
-		// first we fill first person in the need_contacts vector 
-		person* current_person = need_contacts[0];
-		// create set so we uniquely assign people from the need_contacts 
-		// vector to each person's network
-		std::set<size_t> indices_for_networking;
+	// every model but the configuration network is generated in parallel
+	if (parameters.topology.kind != network_topology::model::configuration) {
+		generate_topology();
+		return;
+	}
 
-		// size_t which corresponds to desired number of network contacts
-		// based on if person at first index is a moron and how many contacts 
-		// person has already
-		size_t desired_num_indices = [&current_person]{
+	// generator seeded from the run's seed so a seed always gives the same network
+	sequential_rng g = sequential_rng::substream(seed, network_substream);
 
-			// if moron, return C_m = 20 minus current contacts
-			if (current_person->is_moron) { return (moron_contacts  - current_person->network_size); }
-			// else is normal, return C_m = 9 minus current contacts
-			else                          { return (normal_contacts - current_person->network_size); }
-		
-		} ();
-
-		// upper limit size_t for random generator
-		size_t upper_limit = need_contacts.size() - 1;
-
-		// while we have less indices than we want in the set
-		while ((indices_for_networking.size() < desired_num_indices) && 
-			// and the set is not larger than the need_contacts vector minus 1
-			!(need_contacts.size() - 1 <= indices_for_networking.size())) {
-			// insert random index from one to upper limit (0 is current person)
-			indices_for_networking.insert(spread_engine::random(static_cast<size_t>(1), upper_limit));
-		}
-
-		// for all indices
-		for (size_t index : indices_for_networking) {
-			
-			// put person at index in need_contacts into current_person's network
-			current_person->network.push_back(need_contacts[index]);
-			// put current_person into person at index's network
-			need_contacts[index]->network.push_back(current_person);
-
-			//increase network_size of both
-			current_person->network_size++;
-			need_contacts[index]->network_size++;
-
-			// must check if we have filled the network of need_contacts[index]
-				// if person is moron and network size == max_moron contacts OR
-			if ((need_contacts[index]->is_moron && need_contacts[index]->network_size == moron_contacts) ||
-				// if person is normal and network size == max_normal contacts
-				(!need_contacts[index]->is_moron && need_contacts[index]->network_size == normal_contacts)) {
-				// swap with nullptr (need to preserve need_contacts.size()
-				need_contacts[index]=nullptr;
-			}
+	const size_t total_people = get_population();
 
+	// each person wants the contact number of their group, so their slice of the CSR
+	// neighbor array can be sized up front
+	std::vector<contact_graph::edge_index> offsets(total_people + 1, 0);
+	for (size_t i = 0; i < total_people; ++i) {
+		offsets[i + 1] = offsets[i] + parameters.groups[agent_group[i]].contacts;
+	}
+
+	// need_contacts holds one entry (stub) for every contact a person still needs
+	need_contacts.resize(static_cast<size_t>(offsets.back()));
+	for (size_t i = 0; i < total_people; ++i) {
+		std::fill(need_contacts.begin() + offsets[i], need_contacts.begin() + offsets[i + 1], static_cast<agent_id>(i));
+	}
+
+	// shuffling the stubs and pairing neighbours is the configuration network method,
+	// pair k is made of the stubs at 2k and 2k + 1
+	std::shuffle(need_contacts.begin(), need_contacts.end(), g);
+	// with an odd number of stubs the last one has nobody to pair with
+	if (need_contacts.size() % 2 == 1) { need_contacts.pop_back(); }
+	const size_t total_pairs = need_contacts.size() / 2;
+
+	// contacts are written straight into each person's CSR slice,
+	// filled tracks how much of each slice is already used
+	std::vector<agent_id> neighbors(static_cast<size_t>(offsets.back()), no_agent);
+	std::vector<contact_count> filled(total_people, 0);
+
+	// true if b is already in a's network (networks are at most 20 long, so a scan is cheap)
+	auto are_contacts = [&](const agent_id a, const agent_id b) {
+		const agent_id* first = neighbors.data() + offsets[a];
+		return std::find(first, first + filled[a], b) != first + filled[a];
+	};
+	// puts b into the next free slot of a's network
+	auto add_contact = [&](const agent_id a, const agent_id b) {
+		neighbors[static_cast<size_t>(offsets[a]) + filled[a]++] = b;
+	};
+	// swaps contact from for contact to in a's network
+	auto replace_contact = [&](const agent_id a, const agent_id from, const agent_id to) {
+		agent_id* first = neighbors.data() + offsets[a];
+		*std::find(first, first + filled[a], from) = to;
+	};
+
+	// first pass accepts every pair that is neither a self-loop nor a duplicate contact,
+	// the rest are set aside and their slots in need_contacts marked with no_agent
+	std::vector<std::pair<agent_id, agent_id>> rejected_pairs;
+	std::vector<size_t> rejected_slots;
+	for (size_t k = 0; k < total_pairs; ++k) {
+		agent_id u = need_contacts[2 * k];
+		agent_id v = need_contacts[2 * k + 1];
+
+		if (u != v && !are_contacts(u, v)) {
+			add_contact(u, v);
+			add_contact(v, u);
+		}
+		else {
+			rejected_pairs.emplace_back(u, v);
+			rejected_slots.push_back(k);
+			need_contacts[2 * k] = need_contacts[2 * k + 1] = no_agent;
 		}
+	}
+
+	// second pass rewires each rejected pair (u,v) with a random accepted pair (x,y)
+	// into the pairs (u,x) and (v,y), so every person keeps their network size.
+	// Only a handful of pairs are ever rejected, so this is O(1) work per network
+	static constexpr size_t max_rewire_attempts = 100;
+	for (size_t i = 0; i < rejected_pairs.size() && total_pairs > 1; ++i) {
+		const agent_id u = rejected_pairs[i].first;
+		const agent_id v = rejected_pairs[i].second;
+		std::uniform_int_distribution<size_t> pick_pair(0, total_pairs - 1);
+
+		for (size_t attempt = 0; attempt < max_rewire_attempts; ++attempt) {
+			const size_t k = pick_pair(g);
+			agent_id x = need_contacts[2 * k];
+			agent_id y = need_contacts[2 * k + 1];
+			// skip other rejected pairs
+			if (x == no_agent) { continue; }
+			// use either orientation of the accepted pair
+			if (g() & 1) { std::swap(x, y); }
 
-		// once person at index 0 has a full network, erase them from need_contacts
-		need_contacts.erase(need_contacts.begin());
+			// new pairs must not be self-loops or duplicates themselves
+			if (u == x || v == y || are_contacts(u, x) || are_contacts(v, y)) { continue; }
 
-		// remove all nullptr values that are now full, if there are any
-		need_contacts.erase(std::remove(need_contacts.begin(), need_contacts.end(), nullptr),
-			need_contacts.end());
+			// x and y trade each other for u and v, u and v gain x and y
+			replace_contact(x, y, u);
+			replace_contact(y, x, v);
+			add_contact(u, x);
+			add_contact(v, y);
 
+			need_contacts[2 * k] = u;
+			need_contacts[2 * k + 1] = x;
+			need_contacts[2 * rejected_slots[i]] = v;
+			need_contacts[2 * rejected_slots[i] + 1] = y;
+			break;
+		}
+		// if every attempt failed (only in tiny populations), u and v just end up short a contact
 	}
 
-	// get rid of anything left in need_contacts and get rid of memory allocation for it
+	// get rid of the stubs and get rid of memory allocation for them
 	need_contacts.clear();
 	need_contacts.shrink_to_fit();
 
+	// if anyone ended up short, close the gaps so slices are back to back again
+	if (static_cast<size_t>(offsets.back()) != neighbors.size() ||
+		std::find(neighbors.begin(), neighbors.end(), no_agent) != neighbors.end()) {
+		contact_graph::edge_index packed = 0;
+		for (size_t i = 0; i < total_people; ++i) {
+			const auto first = neighbors.begin() + offsets[i];
+			offsets[i] = packed;
+			std::copy(first, first + filled[i], neighbors.begin() + packed);
+			packed += filled[i];
+		}
+		offsets[total_people] = packed;
+		neighbors.resize(static_cast<size_t>(packed));
+		neighbors.shrink_to_fit();
+	}
+
+	// hand the packed CSR arrays to the contact graph used by each tick
+	std::shared_ptr<contact_graph> built = std::make_shared<contact_graph>();
+	built->assign(std::move(offsets), std::move(neighbors));
+	network = std::move(built);
+
+	// the threshold table is sized by the largest network
+	build_thresholds();
+
+	// contacts closed by an intervention applied before the network existed
+	if (!contact_share.empty()) { update_closed_contacts(); }
 }
 
-void spread_engine::randomly_infect_healthy() {
-	// if user specified they wanted initial_sick to be less than total population
-	if (initial_sick < all_people.size()) {
-		
-		// init set for indices of first sick people
-		std::set<size_t> indices_of_sick;
+void spread_engine::save_network(const std::string& path) const {
+
+	if (class_population) {
+		throw std::logic_error("The tau_leap mode keeps no agents or network!");
+	}
+	if (!partition_starts.empty()) {
+		throw std::logic_error("A partition only holds part of the network!");
+	}
+
+	const size_t total_people = get_population();
+	const snapshot_header header = make_snapshot_header(total_people, counter_groups, network->edge_slots());
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		throw std::runtime_error("Could not open " + path + " for writing!");
+	}
+
+	// pads out to a section's start, then writes it as it sits in memory
+	auto write_section = [&](const std::uint64_t at, const void* data, const size_t bytes) {
+		static const char padding[snapshot_alignment] = {};
+		out.write(padding, static_cast<std::streamsize>(at - static_cast<std::uint64_t>(out.tellp())));
+		out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+	};
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	write_section(header.offsets_at, network->offset_array(), (total_people + 1) * sizeof(contact_graph::edge_index));
+	write_section(header.neighbors_at, network->neighbor_array(), network->edge_slots() * sizeof(agent_id));
+	write_section(header.groups_at, agent_group, total_people);
+
+	if (!out.flush()) {
+		throw std::runtime_error("Could not write " + path + "!");
+	}
+}
+
+void spread_engine::load_network(const std::string& path) {
+
+	if (mode == tick_mode::tau_leap) {
+		throw std::logic_error("The tau_leap mode keeps no agents or network!");
+	}
 
-		// set upper limit for random number generator
-		size_t upper_limit = all_people.size() - 1;
+	snapshot_header header;
+	std::shared_ptr<const mapped_file> file = map_snapshot(path, parameters.groups.size(), header);
+	const size_t groups = parameters.groups.size();
+	const contact_graph::edge_index* offsets =
+		reinterpret_cast<const contact_graph::edge_index*>(file->data() + header.offsets_at);
+	const agent_id* neighbors = reinterpret_cast<const agent_id*>(file->data() + header.neighbors_at);
 
-		// insert random values within the range of all_people into indices_of_sick
-		// until we have # size corresponding to initial_sick
-		while (indices_of_sick.size() < initial_sick) {
-			indices_of_sick.insert(spread_engine::random(static_cast<size_t>(0),upper_limit));
+	// count the group sizes, which also checks every agent's group is one of ours
+	const std::uint8_t* stored_groups = file->data() + header.groups_at;
+	std::vector<size_t> sizes(groups, 0);
+	for (size_t i = 0; i < static_cast<size_t>(header.population); ++i) {
+		if (stored_groups[i] >= groups) {
+			throw std::runtime_error(path + " is truncated or damaged!");
 		}
+		++sizes[stored_groups[i]];
+	}
+
+	// set up the agents exactly as init_spread_network would for this population,
+	// the stub list is only needed for generating a network so it is dropped again
+	group_sizes = sizes;
+	init_spread_network();
+	std::vector<agent_id>().swap(need_contacts);
+
+	// groups are copied so they can be padded for the kernel, the contacts are used in place
+	std::vector<std::uint8_t> padded(stored_groups, stored_groups + static_cast<size_t>(header.population));
+	padded.insert(padded.end(), kernel_padding, 0);
+	assign_groups(std::move(padded));
+	std::shared_ptr<contact_graph> mapped = std::make_shared<contact_graph>();
+	mapped->assign_mapped(std::move(file), offsets, neighbors, static_cast<size_t>(header.population));
+	network = std::move(mapped);
+
+	// the threshold table is sized by the largest network
+	build_thresholds();
+}
+
+void spread_engine::share_network(const spread_engine& source) {
+
+	// same population sizes as the source, with fresh per-agent state
+	if (source.group_sizes.size() != parameters.groups.size()) {
+		throw std::logic_error("Engines sharing a network must have the same number of groups!");
+	}
+	if ((mode == tick_mode::tau_leap) != source.class_population) {
+		throw std::logic_error("Engines sharing a network must both be in tau_leap mode or neither!");
+	}
+	group_sizes = source.group_sizes;
+	init_spread_network();
+	// contact classes have no network to share, each engine draws its own
+	if (class_population) { return; }
+	std::vector<agent_id>().swap(need_contacts);
+
+	// groups and the graph are only referenced
+	group_storage = source.group_storage;
+	agent_group = source.agent_group;
+	network = source.network;
+
+	// the threshold table is sized by the largest network
+	build_thresholds();
+}
+
+void spread_engine::reorder_agents(const contact_graph::ordering kind) {
+
+	if (class_population) {
+		throw std::logic_error("The tau_leap mode keeps no agents or network!");
+	}
+
+	// only a population where everyone is susceptible is the same under any ids
+	if (elapsed_days > 0 || get_total_susceptible() != get_population()) {
+		throw std::logic_error("Agents can only be reordered before anyone is infected!");
+	}
+	if (!partition_starts.empty()) {
+		throw std::logic_error("Agents must be reordered before own_agents!");
+	}
+
+	const size_t total_people = get_population();
+	const std::vector<agent_id> order = network->order(kind);
+	std::vector<agent_id> new_ids(total_people);
+	for (size_t i = 0; i < total_people; ++i) { new_ids[order[i]] = static_cast<agent_id>(i); }
+
+	std::shared_ptr<contact_graph> relabeled = std::make_shared<contact_graph>();
+	relabeled->assign_relabeled(*network, new_ids);
+	network = std::move(relabeled);
 
-		// for every index, mark person as infected, remove them from susceptible,
-		// and place them into infected
-		for (size_t index : indices_of_sick) {
-			susceptible_people[index] = nullptr;
-			update_people_contacts(all_people[index], true);
+	// groups move with their agents, while counters and health are the same for
+	// everyone and susceptible_people lists everyone (or nobody in a compact engine), so
+	// they hold under the new ids
+	std::vector<std::uint8_t> groups(total_people + kernel_padding, 0);
+	for (size_t i = 0; i < total_people; ++i) { groups[i] = agent_group[order[i]]; }
+	assign_groups(std::move(groups));
+
+	// which contacts are closed is drawn by agent id, so it is drawn again for the new ids
+	if (!contact_share.empty()) {
+		std::vector<std::uint64_t>().swap(closed_contacts);
+		update_closed_contacts();
+	}
+}
+
+void spread_engine::randomly_infect_healthy() {
+	// contact classes draw their own sample
+	if (class_population) {
+		classes.infect_initial(initial_sick, group_counts);
+		return;
+	}
+
+	// a partition draws the same sample from the whole population, owned people get
+	// sick and ghosts only count towards their owned contacts
+	auto infect = [&](const agent_id person) {
+		if (person - global_base < owned_last) { update_people_contacts(person - global_base, true); }
+		else { apply_halo(halo_update{ person, +1 }); }
+	};
+
+	// if user specified they wanted initial_sick to be less than total population
+	if (initial_sick < whole_population) {
+
+		// partial Fisher-Yates shuffle: each step swaps a random not yet chosen person
+		// to the back of susceptible_people, so the last initial_sick entries are a
+		// uniform sample and only O(initial_sick) random draws are needed
+		sequential_rng g = sequential_rng::substream(seed, initial_substream);
+		std::vector<agent_id> chosen;
+		if (partition_starts.empty() && !compact_compartments) {
+			size_t remaining = susceptible_people.size();
+			for (size_t i = 0; i < initial_sick; ++i, --remaining) {
+				size_t index = std::uniform_int_distribution<size_t>(0, remaining - 1)(g);
+				susceptible_people.swap_places(index, remaining - 1);
+			}
+			chosen.assign(susceptible_people.begin() + remaining, susceptible_people.end());
+		}
+		else {
+			// partitions and compact engines keep no susceptible list, so the swaps are
+			// made on the list of every agent in order a fresh engine starts with, keeping
+			// only moved entries. A compact engine where someone is already sick draws
+			// from its susceptible people in order instead
+			std::vector<agent_id> listed;
+			const bool everyone = !partition_starts.empty() || total_in(susceptible) == whole_population;
+			if (!everyone) {
+				for (size_t i = 0; i < whole_population; ++i) {
+					if (health[i] == susceptible) { listed.push_back(static_cast<agent_id>(i)); }
+				}
+			}
+			const size_t candidates = everyone ? whole_population : listed.size();
+			size_t remaining = candidates;
+			std::unordered_map<size_t, agent_id> moved;
+			auto at = [&](const size_t index) {
+				const auto found = moved.find(index);
+				if (found != moved.end()) { return found->second; }
+				return everyone ? static_cast<agent_id>(index) : listed[index];
+			};
+			for (size_t i = 0; i < initial_sick; ++i, --remaining) {
+				size_t index = std::uniform_int_distribution<size_t>(0, remaining - 1)(g);
+				const agent_id picked = at(index);
+				moved[index] = at(remaining - 1);
+				moved[remaining - 1] = picked;
+			}
+			for (size_t index = remaining; index < candidates; ++index) { chosen.push_back(at(index)); }
 		}
+
+		// for every chosen person, mark them as infected, which moves them from
+		// susceptible into infected
+		for (agent_id person : chosen) { infect(person); }
+		prune_compartments();
 	}
 
 	// else user specified they wanted either whole population or 
 	// more than whole population sick, so just make everyone sick
 	else {
-		// for person in all person, mark them sick, put them in infected,
+		// for every agent, mark them sick, put them in infected,
 		// and update their network
-		for (person* my_person: all_people) {
-			update_people_contacts(my_person, true);
-		}
-		// remove them from susceptible
-		for (size_t i = 0; i < susceptible_people.size(); ++i) {
-			susceptible_people[i] = nullptr;
-		}
+		for (size_t i = 0; i < whole_population; ++i) { infect(static_cast<agent_id>(i)); }
+		prune_compartments();
 	}
-	
-	// remove all nullptrs from susceptible_people that we created above
-	susceptible_people.erase(std::remove(susceptible_people.begin(), susceptible_people.end(), nullptr),
-		susceptible_people.end());
 
 }
 
 
-void spread_engine::update_people_contacts(person* for_updating, bool is_sick) {
-	
+void spread_engine::update_people_contacts(const agent_id for_updating, const bool is_sick) {
+
+	SPREAD_PROFILE_COUNT(profile, edges_touched, network->degree(for_updating));
+
 	// if person is supposed to be infected
 	if (is_sick) {
 
-		// add them to infected people vector
-		infected_people.push_back(for_updating);
+		// move them into infected and pick their removal day
+		move_compartment(for_updating, susceptible, infected);
+		health[for_updating] = infected;
+		schedule_removal(for_updating, removal_word(for_updating));
 
-		// if the person is a moron
-		if (for_updating->is_moron) {
-			// for everyone in their network
-			for (person* has_infected_contact : for_updating->network) {
-				// add one moron ill contact to each
-				has_infected_contact->ill_moron_contacts++;
-			}
-			// decrement susceptible moron count and increment infected moron count
-			susceptible_moron--;
-			infected_moron++;
-		}
-		else { //else the new person is a normal
-			// for everyone in their network
-			for (person* has_infected_contact : for_updating->network) {
-				// add one normal ill contact to each
-				has_infected_contact->ill_normal_contacts++;
-			}
-			// decrement susceptible normal count and increment infected normal count
-			susceptible_normal--;
-			infected_normal++;
+		// for everyone in their network
+		contact_count* counters = ill_counters(agent_group[for_updating]);
+		for (const agent_id& has_infected_contact : network->contacts(for_updating)) {
+			// contacts owned by another partition hear about it through the halo, and
+			// closed contacts are not met
+			if (!owns(has_infected_contact) || !is_open(has_infected_contact)) { continue; }
+			// add one ill contact of the person's group to each, they are now at risk
+			counters[has_infected_contact]++;
+			mark_at_risk(has_infected_contact);
 		}
-
-		
+		// decrement their group's susceptible count and increment its infected count
+		move_count(for_updating, susceptible, infected);
 	}
 
 	// else the person is supposed to be removed
 	else {
 
-		// if the person is a moron
-		if (for_updating->is_moron) {
-			// for everyone in their network
-			for (person* has_infected_contact : for_updating->network) {
-				// subtract one moron ill contact from each
-				has_infected_contact->ill_moron_contacts--;
-			}
-			// decrement infected moron count and increment removed moron count
-			infected_moron--;
-			removed_moron++;
+		move_compartment(for_updating, infected, removed);
+		health[for_updating] = removed;
+
+		// for everyone in their network
+		contact_count* counters = ill_counters(agent_group[for_updating]);
+		for (const agent_id& has_infected_contact : network->contacts(for_updating)) {
+			if (!owns(has_infected_contact) || !is_open(has_infected_contact)) { continue; }
+			// subtract one ill contact of the person's group from each
+			counters[has_infected_contact]--;
 		}
-		// else the person is a normal
-		else {
-			// for everyone in their network
-			for (person* has_infected_contact : for_updating->network) {
-				// subtract one normal ill contact from each
-				has_infected_contact->ill_normal_contacts--;
-			}
-			// decrement infected normal count and increment removed normal count
-			infected_normal--;
-			removed_normal++;
-		}	
+		// decrement their group's infected count and increment its removed count
+		move_count(for_updating, infected, removed);
 	}
 }
 
-void spread_engine::infect_healthy_people() {
+void spread_engine::build_thresholds() {
 
 	// delta_t (really not strictly necessary due to being 1.0)
 	// for exp() expression
 	static constexpr double delta_t = 1.0;
 
-	// for everyone in the susceptible_people vector
-	for (size_t i = 0; i < susceptible_people.size(); ++i) {
-		// if person has any contact with ill people in their network
-		if (susceptible_people[i]->ill_moron_contacts + susceptible_people[i]->ill_normal_contacts > 0) {
-			// n = b(u*(ill normals) + ill morons)
+	const size_t groups = parameters.groups.size();
+
+	// weight of one ill contact of group h for a susceptible agent of group g
+	hazard_weights.resize(groups * groups);
+	for (size_t g = 0; g < groups; ++g) {
+		for (size_t h = 0; h < groups; ++h) {
+			hazard_weights[g * groups + h] = parameters.mixing_weight(g, h) * parameters.groups[h].mask *
+				(mask_scale.empty() ? 1.0 : mask_scale[h]);
+		}
+	}
+
+	// nobody can have more ill contacts of any group than their network size, a
+	// partition sizes the table by the whole network so it decides like one engine
+	threshold_stride = std::max(network->max_degree(), widest_network) + 1;
+
+	// one factor per (group, contact group, count) for the hazard kernel
+	survival_factors.resize(groups * groups * threshold_stride);
+	for (size_t pair = 0; pair < groups * groups; ++pair) {
+		for (size_t count = 0; count < threshold_stride; ++count) {
+			survival_factors[pair * threshold_stride + count] =
+				std::exp(-parameters.beta * hazard_weights[pair] * static_cast<double>(count) * delta_t);
+		}
+	}
+
+	// the table needs an entry for every group and every combination of counts, which
+	// only stays small for a few groups
+	size_t entries = groups;
+	for (size_t h = 0; h < groups && entries <= max_threshold_entries; ++h) { entries *= threshold_stride; }
+	if (entries > max_threshold_entries) {
+		std::vector<std::uint32_t>().swap(infection_thresholds);
+	}
+	else {
+		infection_thresholds.resize(entries);
+		std::vector<size_t> counts(groups, 0);
+		for (size_t index = 0; index < entries; ++index) {
+			// the index is the group followed by the counts as digits, last group fastest
+			size_t digits = index;
+			for (size_t h = groups; h-- > 0;) {
+				counts[h] = digits % threshold_stride;
+				digits /= threshold_stride;
+			}
+			const size_t g = digits;
+
+			// n = b * sum over h of weight(g, h) * (ill contacts of group h)
 			//set eta based on above expression
-			double eta = beta * ((mu * susceptible_people[i]->ill_normal_contacts)
-				+ susceptible_people[i]->ill_moron_contacts);
-			
+			double weighted = 0.0;
+			for (size_t h = 0; h < groups; ++h) {
+				weighted += hazard_weights[g * groups + h] * static_cast<double>(counts[h]);
+			}
+			const double eta = parameters.beta * weighted;
+
 			// probability of getting sick is 
 			// 1 - e^( -eta * delta_t)
-			double prb_get_sick = 1.0 - std::exp(-(eta)*delta_t);
-
-			// if a random number between a non-zero double and one is less than or
-			// equal to our probability, (happens {prb_get_sick * 100}% of the time)
-			// update person as sick and take them out of susceptible people vector
-			if (spread_engine::random(0.000001,1.0) <= prb_get_sick) {
-				update_people_contacts(susceptible_people[i], true);
-				susceptible_people[i] = nullptr;
+			infection_thresholds[index] = probability_threshold(1.0 - std::exp(-(eta)*delta_t));
+		}
+	}
+
+	removal_log_survival = std::log1p(-parameters.gamma);
+}
+
+double spread_engine::infection_rate(const agent_id person) const {
+	const double* weights = hazard_weights.data() + agent_group[person] * counter_groups;
+	double weighted = 0.0;
+	for (size_t h = 0; h < counter_groups; ++h) {
+		weighted += weights[h] * static_cast<double>(ill_counters(h)[person]);
+	}
+	return parameters.beta * weighted;
+}
+
+bool spread_engine::kernel_decision(const agent_id person, const std::uint32_t word) const {
+
+	// the chance of staying healthy is the product of every group's survival factor,
+	// the word is below the threshold floor((1 - survival) * 2^32) exactly when word + 1 is
+	// at most (1 - survival) * 2^32, which needs no rounding to an integer
+	const double* factors = survival_factors.data() + agent_group[person] * counter_groups * threshold_stride;
+	double survival = 1.0;
+	for (size_t h = 0; h < counter_groups; ++h) {
+		survival *= factors[h * threshold_stride + ill_counters(h)[person]];
+	}
+	return static_cast<double>(word) + 1.0 <= std::ldexp(1.0 - survival, 32);
+}
+
+void spread_engine::decide_infections(const agent_id* people, const std::uint32_t* words, const size_t count, std::uint8_t* sick) const {
+
+	size_t i = 0;
+	if (!infection_thresholds.empty()) {
+		for (; i < count; ++i) { sick[i] = words[i] < infection_thresholds[threshold_index(people[i])]; }
+		return;
+	}
+
+#if defined(__AVX2__)
+	// four people at a time: gather their groups and counters, gather and multiply one
+	// survival factor per group, then compare against the words. The gathers use 32 bit
+	// signed offsets and read whole 32 bit words, hence the population limit and the
+	// padding past the last agent
+	if (get_population() <= static_cast<size_t>(std::numeric_limits<std::int32_t>::max())) {
+		const size_t groups = counter_groups;
+		const __m128i byte_mask = _mm_set1_epi32(0xff);
+		const __m128i half_mask = _mm_set1_epi32(0xffff);
+		const __m128i sign_bit = _mm_set1_epi32(static_cast<int>(0x80000000u));
+		const __m128i group_count = _mm_set1_epi32(static_cast<int>(groups));
+		const __m128i stride = _mm_set1_epi32(static_cast<int>(threshold_stride));
+		// the words are unsigned, flipping the sign bit and adding 2^31 back converts them exactly
+		const __m256d word_offset = _mm256_set1_pd(2147483648.0 + 1.0);
+		const __m256d one = _mm256_set1_pd(1.0);
+		const __m256d scale = _mm256_set1_pd(4294967296.0);
+		const int* group_base = reinterpret_cast<const int*>(agent_group);
+
+		for (; i + 4 <= count; i += 4) {
+			const __m128i ids = _mm_loadu_si128(reinterpret_cast<const __m128i*>(people + i));
+			const __m128i group = _mm_and_si128(_mm_i32gather_epi32(group_base, ids, 1), byte_mask);
+			// first factor of each person's row, (g * groups + h) * stride for h = 0
+			__m128i row = _mm_mullo_epi32(_mm_mullo_epi32(group, group_count), stride);
+
+			__m256d survival = one;
+			for (size_t h = 0; h < groups; ++h) {
+				const int* counter_base = reinterpret_cast<const int*>(ill_counters(h));
+				const __m128i counts = _mm_and_si128(_mm_i32gather_epi32(counter_base, ids, 2), half_mask);
+				survival = _mm256_mul_pd(survival,
+					_mm256_i32gather_pd(survival_factors.data(), _mm_add_epi32(row, counts), 8));
+				row = _mm_add_epi32(row, stride);
 			}
+
+			const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+			const __m256d word = _mm256_add_pd(_mm256_cvtepi32_pd(_mm_xor_si128(raw, sign_bit)), word_offset);
+			const __m256d threshold = _mm256_mul_pd(_mm256_sub_pd(one, survival), scale);
+			const int decided = _mm256_movemask_pd(_mm256_cmp_pd(word, threshold, _CMP_LE_OQ));
+			sick[i] = decided & 1;
+			sick[i + 1] = (decided >> 1) & 1;
+			sick[i + 2] = (decided >> 2) & 1;
+			sick[i + 3] = (decided >> 3) & 1;
 		}
-		
 	}
+#endif
 
-	// remove all nullptrs from susceptible_people that we created above
-	susceptible_people.erase(std::remove(susceptible_people.begin(), susceptible_people.end(), nullptr),
-		susceptible_people.end());
+	// whatever is left goes one at a time with the same arithmetic
+	for (; i < count; ++i) { sick[i] = kernel_decision(people[i], words[i]); }
 }
 
-void spread_engine::remove_infected_people() {
+void spread_engine::mark_at_risk(const agent_id person) {
+	if (health[person] == susceptible && !listed_at_risk(person)) {
+		set_listed_at_risk(person, true);
+		at_risk_people.push_back(person);
+	}
+}
 
-	// delta_t (really not strictly necessary due to being 1.0)
-	// for exp() expression
-	static constexpr double delta_t = 1.0;
+void spread_engine::prune_compartments() {
+
+	// someone stays in the frontier while susceptible with an ill contact
+	auto leaves_frontier = [this](const agent_id person) {
+		if (health[person] == susceptible && has_ill_contacts(person)) {
+			return false;
+		}
+		set_listed_at_risk(person, false);
+		return true;
+	};
+
+	// compact the sorted prefix and the newcomers separately, then slide the newcomers down
+	const auto sorted_end = std::remove_if(at_risk_people.begin(), at_risk_people.begin() + sorted_at_risk, leaves_frontier);
+	const auto newcomers_end = std::remove_if(at_risk_people.begin() + sorted_at_risk, at_risk_people.end(), leaves_frontier);
+	const auto frontier_end = std::move(at_risk_people.begin() + sorted_at_risk, newcomers_end, sorted_end);
+
+	// sort the newcomers and merge them in, which costs far less than sorting everything
+	std::sort(sorted_end, frontier_end);
+	std::inplace_merge(at_risk_people.begin(), sorted_end, frontier_end);
+	at_risk_people.erase(frontier_end, at_risk_people.end());
+	sorted_at_risk = at_risk_people.size();
+}
+
+void spread_engine::schedule_removal(const agent_id person, const std::uint32_t word) {
+
+	// removal days further out than this are treated as never
+	static constexpr double max_calendar_days = 1 << 20;
+
+	// with gamma == 1 everyone leaves the day they get sick, with gamma == 0 nobody does
+	if (removal_log_survival >= 0.0) { return; }
+	double days = 0.0;
+	if (std::isfinite(removal_log_survival)) {
+		// u in (0, 1) from the word, then invert the geometric distribution
+		const double u = (static_cast<double>(word) + 0.5) * 0x1.0p-32;
+		days = std::floor(std::log(u) / removal_log_survival);
+		if (days >= max_calendar_days) { return; }
+	}
+	removals.schedule(person, static_cast<size_t>(elapsed_days) + static_cast<size_t>(days));
+}
+
+std::uint32_t spread_engine::removal_word(const agent_id person) {
+	if (mode == tick_mode::immediate) { return immediate_word(); }
+	return draw_stream(seed, elapsed_days, removal_draw).word(person + global_base);
+}
+
+void spread_engine::infect_healthy_people() {
 
-	// for everyone in the infected_people vector
-	for (size_t i = 0; i < infected_people.size(); ++i) {
-		// if a random number between a non-zero double and one is less than or
-		// equal to gamma, (happens {gamma * 100}% of the time)
-		// update person as renmoved and take them out of infected people vector
-		if (spread_engine::random(0.000001, 1.0) <= gamma) {
-			update_people_contacts(infected_people[i], false);
-			infected_people[i] = nullptr;
+	// for everyone in the frontier, including people who join it during this sweep
+	for (size_t i = 0; i < at_risk_people.size(); ++i) {
+		agent_id current_person = at_risk_people[i];
+		// if person has any contact with ill people in their network
+		if (has_ill_contacts(current_person)) {
+			// if a random 32 bit word is below the person's threshold (happens with
+			// probability 1 - e^( -eta * delta_t)), update person as sick,
+			// prune_compartments then takes them out of the frontier
+			if (infection_decision(current_person, immediate_word())) {
+				update_people_contacts(current_person, true);
+			}
 		}
+		
 	}
+	SPREAD_PROFILE_COUNT(profile, agents_scanned, at_risk_people.size());
+	SPREAD_PROFILE_LAP(profile, hazard_sweep);
+
+	// drop everyone who got sick or is no longer at risk
+	prune_compartments();
+	SPREAD_PROFILE_LAP(profile, compaction);
+}
+
+void spread_engine::remove_infected_people() {
 
-	// remove all nullptrs from infected_people that we created above
-	infected_people.erase(std::remove(infected_people.begin(), infected_people.end(), nullptr),
-		infected_people.end());
+	// for everyone whose removal day is today, including people who got sick today,
+	// update person as removed
+	for (agent_id person : removals.due()) {
+		update_people_contacts(person, false);
+	}
+	removals.advance();
+	SPREAD_PROFILE_LAP(profile, removals);
 }
 
 void spread_engine::tick() {
 
+	// classes and agents cannot stand in for each other
+	if (class_population != (mode == tick_mode::tau_leap)) {
+		throw std::logic_error("The population was set up for another tick mode, call init_spread_network again!");
+	}
+	SPREAD_PROFILE_DAY(profile, elapsed_days);
+
+	// today's interventions come first, next_reaction mode applies them as it reaches them
+	if (mode != tick_mode::next_reaction) { apply_due_interventions(); }
+	SPREAD_PROFILE_LAP(profile, interventions);
+
+	if (class_population) {
+		SPREAD_PROFILE_COUNT(profile, agents_scanned, classes.occupied_classes());
+		// classes only see the masks of the parameters, so the scales go into a copy
+		if (mask_scale.empty()) { classes.tick(parameters, group_counts); }
+		else {
+			spread_parameters scaled = parameters;
+			for (size_t group = 0; group < scaled.groups.size(); ++group) { scaled.groups[group].mask *= mask_scale[group]; }
+			classes.tick(scaled, group_counts);
+		}
+		SPREAD_PROFILE_LAP(profile, hazard_sweep);
+		++elapsed_days;
+		return;
+	}
+
+	// a partition only knows its own agents, which only the synchronous sweeps respect
+	if (halo != nullptr && mode != tick_mode::synchronous) {
+		throw std::logic_error("Partitioned engines can only tick synchronously!");
+	}
+	// next-reaction mode fires every event of the coming day
+	if (mode == tick_mode::next_reaction) {
+		run_until(static_cast<size_t>(elapsed_days) + 1);
+		return;
+	}
+	// daily modes need the compartment vectors back if events were running
+	if (events_scheduled) { unschedule_events(); }
+
+	// synchronous mode has its own two-phase sweeps
+	if (mode == tick_mode::synchronous) {
+		synchronous_tick();
+		return;
+	}
+
 	//call infect and remove functions
 	infect_healthy_people();
 	remove_infected_people();
 	//increment elapsed days
 	++elapsed_days;
 
-}
\ No newline at end of file
+}
+
+void spread_engine::decide_in_chunks(std::vector<agent_id>& people, const draw_stream& draws) {
+
+	// chunks are fixed size, so the split never depends on the thread count
+	const size_t chunks = (people.size() + chunk_size - 1) / chunk_size;
+	if (chunk_transitions.size() < chunks) { chunk_transitions.resize(chunks); }
+	if (chunk_words.size() < chunks) { chunk_words.resize(chunks); }
+	if (chunk_decisions.size() < chunks) { chunk_decisions.resize(chunks); }
+	SPREAD_PROFILE_COUNT(profile, agents_scanned, people.size());
+	SPREAD_PROFILE_COUNT(profile, rng_draws, people.size());
+
+	// decision phase: each chunk only reads people and the engine, and writes its own lists
+	workers.run(chunks, [&](const size_t chunk) {
+		std::vector<std::uint32_t>& leaving = chunk_transitions[chunk];
+		std::vector<std::uint32_t>& words = chunk_words[chunk];
+		std::vector<std::uint8_t>& sick = chunk_decisions[chunk];
+		leaving.clear();
+		const size_t first = chunk * chunk_size;
+		const size_t last = std::min(people.size(), first + chunk_size);
+
+		// words for the whole chunk are generated in one pass before any are used,
+		// then the whole chunk is decided in one pass as well
+		words.resize(last - first);
+		sick.resize(last - first);
+		draws.fill(people.data() + first, last - first, words.data(), global_base);
+		decide_infections(people.data() + first, words.data(), last - first, sick.data());
+		for (size_t i = first; i < last; ++i) {
+			if (sick[i - first]) { leaving.push_back(static_cast<std::uint32_t>(i)); }
+		}
+	});
+	SPREAD_PROFILE_LAP(profile, hazard_sweep);
+
+	// leavers are collected in chunk order, the same order a single thread would find them
+	changed_people.clear();
+	for (size_t chunk = 0; chunk < chunks; ++chunk) {
+		for (std::uint32_t i : chunk_transitions[chunk]) {
+			changed_people.push_back(people[i]);
+			people[i] = no_agent;
+		}
+	}
+
+	// remove all no_agent values from people that we created above
+	people.erase(std::remove(people.begin(), people.end(), no_agent), people.end());
+	SPREAD_PROFILE_LAP(profile, compaction);
+}
+
+void spread_engine::scatter_contacts(const int delta) {
+
+	const size_t blocks = (get_population() >> scatter_block_bits) + 1;
+	const size_t groups = counter_groups;
+	// changed_people is split into one part per thread, counter updates commute,
+	// so unlike the decision phase this split may depend on the thread count
+	const size_t parts = std::min(workers.size(), changed_people.size());
+	if (parts == 0) { return; }
+	if (scatter_buffers.size() < parts) { scatter_buffers.resize(parts); }
+
+	// a mapped network is read in windows of ascending agent ids, so people are sorted
+	// and each window's end is where its contacts pass scatter_window_bytes. A network
+	// in memory is one window. Counter updates commute, so the order changes nothing
+	const bool windowed = network->is_mapped();
+	scatter_windows.clear();
+	if (windowed) {
+		std::sort(changed_people.begin(), changed_people.end());
+		const contact_graph::edge_index* offsets = network->offset_array();
+		const contact_graph::edge_index window_slots = scatter_window_bytes / sizeof(agent_id);
+		for (size_t first = 0; first < changed_people.size(); ) {
+			const contact_graph::edge_index limit = offsets[changed_people[first]] + window_slots;
+			const auto end = std::partition_point(changed_people.begin() + first, changed_people.end(),
+				[&](const agent_id person) { return offsets[person] < limit; });
+			first = std::max(first + 1, static_cast<size_t>(end - changed_people.begin()));
+			scatter_windows.push_back(first);
+		}
+	}
+	else {
+		scatter_windows.push_back(changed_people.size());
+	}
+	const bool drop_behind = windowed && network->edge_slots() * sizeof(agent_id) > graph_cache_bytes;
+
+	// agents from a window's first person to one past its last
+	auto advise_window = [&](const size_t window, const mapped_file::access expected) {
+		const size_t first = window == 0 ? 0 : scatter_windows[window - 1];
+		network->advise(changed_people[first], changed_people[scatter_windows[window] - 1] + 1, expected);
+	};
+
+	// bucket phase: every part files the contacts of its people by block
+	workers.run(parts, [&](const size_t part) {
+		std::vector<std::vector<agent_id>>& buckets = scatter_buffers[part];
+		buckets.resize(groups * blocks);
+		for (std::vector<agent_id>& bucket : buckets) { bucket.clear(); }
+	});
+	for (size_t window = 0; window < scatter_windows.size(); ++window) {
+		// the next window is read in while this one is bucketed
+		if (windowed && window + 1 < scatter_windows.size()) {
+			advise_window(window + 1, mapped_file::access::will_need);
+		}
+
+		const size_t window_first = window == 0 ? 0 : scatter_windows[window - 1];
+		const size_t window_size = scatter_windows[window] - window_first;
+		const size_t window_parts = std::min(parts, window_size);
+		workers.run(window_parts, [&](const size_t part) {
+			std::vector<std::vector<agent_id>>& buckets = scatter_buffers[part];
+			const size_t first = window_first + window_size * part / window_parts;
+			const size_t last = window_first + window_size * (part + 1) / window_parts;
+			for (size_t i = first; i < last; ++i) {
+				const agent_id person = changed_people[i];
+				for (const agent_id& contact : network->contacts(person)) {
+					// contacts owned by another partition hear about it through the halo
+					if (!owns(contact) || !is_open(contact)) { continue; }
+					buckets[groups * (contact >> scatter_block_bits) + agent_group[person]].push_back(contact);
+				}
+			}
+		});
+
+		if (drop_behind) {
+			advise_window(window, mapped_file::access::dont_need);
+		}
+	}
+
+	// apply phase: each block's counters and frontier flags are only written by the
+	// thread applying it, susceptible contacts who gain an ill contact join the frontier
+	if (scatter_at_risk.size() < blocks) { scatter_at_risk.resize(blocks); }
+	workers.run(blocks, [&](const size_t block) {
+		std::vector<agent_id>& joined = scatter_at_risk[block];
+		joined.clear();
+		auto note_at_risk = [&](const agent_id contact) {
+			if (delta > 0 && health[contact] == susceptible && !listed_at_risk(contact)) {
+				set_listed_at_risk(contact, true);
+				joined.push_back(contact);
+			}
+		};
+		for (size_t part = 0; part < parts; ++part) {
+			for (size_t group = 0; group < groups; ++group) {
+				contact_count* counters = ill_counters(group);
+				for (agent_id contact : scatter_buffers[part][groups * block + group]) {
+					counters[contact] = static_cast<contact_count>(counters[contact] + delta);
+					note_at_risk(contact);
+				}
+			}
+		}
+	});
+
+	// new frontier members are appended in block order
+	for (size_t block = 0; block < blocks; ++block) {
+		at_risk_people.insert(at_risk_people.end(), scatter_at_risk[block].begin(), scatter_at_risk[block].end());
+	}
+}
+
+bool spread_engine::should_pull(const size_t changed_slots) const {
+	if (halo != nullptr || direction == propagation::push) { return false; }
+	if (direction == propagation::pull) { return true; }
+	// a pull reads the contacts of every susceptible person, estimated from the mean degree
+	const size_t population = get_population();
+	const size_t susceptible_slots = population == 0 ? 0 :
+		static_cast<size_t>(static_cast<double>(total_in(susceptible)) * network->edge_slots() / population);
+	return changed_slots * pushed_contact_cost > susceptible_slots + (population >> pull_agent_cost_shift);
+}
+
+void spread_engine::build_infected_bits() {
+	const size_t total_people = get_population();
+	const size_t words = (total_people + 63) / 64;
+	infected_bits.resize(words);
+	const size_t word_chunks = (words + chunk_size - 1) / chunk_size;
+	workers.run(word_chunks, [&](const size_t chunk) {
+		const size_t last = std::min(words, (chunk + 1) * chunk_size);
+		for (size_t word = chunk * chunk_size; word < last; ++word) {
+			std::uint64_t bits = 0;
+			const size_t first_agent = word * 64;
+			const size_t agents = std::min<size_t>(64, total_people - first_agent);
+			for (size_t bit = 0; bit < agents; ++bit) {
+				bits |= std::uint64_t(health[first_agent + bit] == infected) << bit;
+			}
+			infected_bits[word] = bits;
+		}
+	});
+}
+
+void spread_engine::pull_contacts() {
+
+	const size_t total_people = owned_last;
+	const size_t groups = counter_groups;
+
+	// one bit per agent, so the lookups below mostly hit cache even on large populations
+	build_infected_bits();
+
+	// every owned susceptible person only writes their own counters and frontier flag
+	const size_t chunks = (total_people + chunk_size - 1) / chunk_size;
+	if (chunk_at_risk.size() < chunks) { chunk_at_risk.resize(chunks); }
+	workers.run(chunks, [&](const size_t chunk) {
+		std::vector<agent_id>& at_risk = chunk_at_risk[chunk];
+		at_risk.clear();
+		std::vector<contact_count> counts(groups);
+		[[maybe_unused]] size_t read_slots = 0;
+		const size_t last = std::min(total_people, (chunk + 1) * chunk_size);
+		for (size_t i = chunk * chunk_size; i < last; ++i) {
+			const agent_id person = static_cast<agent_id>(i);
+			if (health[person] != susceptible) { continue; }
+			std::fill(counts.begin(), counts.end(), 0);
+			contact_count any = 0;
+			const contact_graph::contact_range contacts = network->contacts(person);
+			read_slots += contacts.size();
+			for (const agent_id& contact : contacts) {
+				if ((infected_bits[contact >> 6] >> (contact & 63) & 1) && is_open(contact)) {
+					++counts[agent_group[contact]];
+					any = 1;
+				}
+			}
+			for (size_t group = 0; group < groups; ++group) { ill_counters(group)[person] = counts[group]; }
+			set_listed_at_risk(person, any > 0);
+			if (any) { at_risk.push_back(person); }
+		}
+		SPREAD_PROFILE_COUNT(profile, edges_touched, read_slots);
+	});
+
+	// the frontier is rebuilt whole, in agent_id order
+	at_risk_people.clear();
+	for (size_t chunk = 0; chunk < chunks; ++chunk) {
+		at_risk_people.insert(at_risk_people.end(), chunk_at_risk[chunk].begin(), chunk_at_risk[chunk].end());
+	}
+	sorted_at_risk = at_risk_people.size();
+}
+
+void spread_engine::synchronous_tick() {
+
+	// streams for today's draws, each agent draws at most once from each
+	// (the removal stream picks the removal days of people infected today)
+	const draw_stream infection_draws(seed, elapsed_days, infection_draw);
+	const draw_stream removal_draws(seed, elapsed_days, removal_draw);
+
+	// decide every infection in the frontier against the ill contact counts from the start of the day,
+	// everyone in it has an ill contact, so nobody with a zero hazard spends a draw
+	decide_in_chunks(at_risk_people, infection_draws);
+
+	// compaction kept the frontier in order, the scatter below appends newcomers after it
+	sorted_at_risk = at_risk_people.size();
+
+	// move the newly sick into infected, pick their removal day and update the S and I counts
+	removal_words.resize(changed_people.size());
+	removal_draws.fill(changed_people.data(), changed_people.size(), removal_words.data(), global_base);
+	for (size_t i = 0; i < changed_people.size(); ++i) {
+		const agent_id person = changed_people[i];
+		move_compartment(person, susceptible, infected);
+		health[person] = infected;
+		set_listed_at_risk(person, false);
+		schedule_removal(person, removal_words[i]);
+		move_count(person, susceptible, infected);
+	}
+	SPREAD_PROFILE_COUNT(profile, rng_draws, changed_people.size());
+	SPREAD_PROFILE_LAP(profile, transitions);
+
+	// today's changes are pushed to the counters unless they have so many contacts that
+	// recounting every susceptible person is cheaper, which is decided once both are known
+	size_t changed_slots = 0;
+	for (agent_id person : changed_people) { changed_slots += network->degree(person); }
+	for (agent_id person : removals.due()) { changed_slots += network->degree(person); }
+	const bool pull = should_pull(changed_slots);
+
+	// then add them to their contacts' counters in one batch
+	if (!pull) {
+		scatter_contacts(+1);
+		queue_halo(+1);
+		SPREAD_PROFILE_COUNT(profile, edges_touched, changed_slots);
+	}
+	SPREAD_PROFILE_LAP(profile, counter_scatter);
+
+	// everyone whose removal day is today leaves, including those infected today
+	changed_people.assign(removals.due().begin(), removals.due().end());
+	removals.advance();
+
+	// update the I and R counts
+	for (agent_id person : changed_people) {
+		move_compartment(person, infected, removed);
+		health[person] = removed;
+		move_count(person, infected, removed);
+	}
+	SPREAD_PROFILE_LAP(profile, removals);
+	// then take them off their contacts' counters in one batch, or recount everyone's
+	if (!pull) {
+		scatter_contacts(-1);
+		queue_halo(-1);
+	}
+	else {
+		pull_contacts();
+	}
+
+	// trade the day's changes of boundary agents with the other partitions
+	if (halo != nullptr) { exchange_halo(); }
+	SPREAD_PROFILE_LAP(profile, counter_scatter);
+
+	// drop people from the frontier whose ill contacts were all removed
+	prune_compartments();
+	SPREAD_PROFILE_LAP(profile, compaction);
+
+	//increment elapsed days
+	++elapsed_days;
+
+}
+
+void spread_engine::own_agents(const std::vector<std::uint32_t>& starts, const size_t index, halo_channel& channel) {
+
+	// the whole network and groups are kept until the partition is built from them
+	const std::shared_ptr<const contact_graph> whole = network;
+	const size_t total_people = get_population();
+	const std::vector<std::uint8_t> groups(agent_group, agent_group + total_people);
+	build_partition(whole->offset_array(), whole->neighbor_array(), groups.data(), total_people, starts, index, channel);
+}
+
+void spread_engine::load_partition(const std::string& path, const size_t parts, const size_t index, halo_channel& channel) {
+
+	if (mode != tick_mode::synchronous) {
+		throw std::logic_error("Partitioned engines can only tick synchronously!");
+	}
+	if (index >= parts) {
+		throw std::logic_error("Partitions must cover the population in order!");
+	}
+
+	// the file stays mapped while the partition is built, past the offsets only the
+	// pages of the partition's own contacts and groups are read
+	snapshot_header header;
+	const std::shared_ptr<const mapped_file> file = map_snapshot(path, parameters.groups.size(), header);
+	const contact_graph::edge_index* offsets =
+		reinterpret_cast<const contact_graph::edge_index*>(file->data() + header.offsets_at);
+	const agent_id* neighbors = reinterpret_cast<const agent_id*>(file->data() + header.neighbors_at);
+	const size_t population = static_cast<size_t>(header.population);
+	build_partition(offsets, neighbors, file->data() + header.groups_at, population,
+		cut_by_contacts(offsets, population, parts), index, channel);
+}
+
+void spread_engine::build_partition(const contact_graph::edge_index* offsets, const agent_id* neighbors,
+	const std::uint8_t* groups, const size_t population, const std::vector<std::uint32_t>& starts, const size_t index,
+	halo_channel& channel) {
+
+	if (mode != tick_mode::synchronous) {
+		throw std::logic_error("Partitioned engines can only tick synchronously!");
+	}
+	if (starts.size() < 2 || index + 1 >= starts.size() || starts.front() != 0 ||
+		starts.back() != population || !std::is_sorted(starts.begin(), starts.end())) {
+		throw std::logic_error("Partitions must cover the population in order!");
+	}
+	const agent_id first = starts[index];
+	const size_t owned = static_cast<size_t>(starts[index + 1] - first);
+
+	// owner of any agent, found by its range
+	auto owner = [&](const agent_id person) {
+		return static_cast<std::uint32_t>(std::upper_bound(starts.begin(), starts.end(), person) - starts.begin() - 1);
+	};
+
+	// contacts are symmetric, so scanning the owned agents' own contacts finds both
+	// every ghost and every boundary agent's partitions. Ghosts are marked in a bitmap of
+	// the population, and boundary agents' partitions are packed into CSR form like the
+	// contact graph as they are found
+	std::vector<std::uint64_t> is_ghost((population + 63) / 64, 0);
+	std::vector<agent_id> boundary;
+	std::vector<size_t> boundary_starts(1, 0);
+	std::vector<std::uint32_t> boundary_owners;
+	for (size_t person = 0; person < owned; ++person) {
+		const size_t found = boundary_owners.size();
+		for (contact_graph::edge_index slot = offsets[first + person]; slot < offsets[first + person + 1]; ++slot) {
+			const agent_id contact = neighbors[slot];
+			if (contact - first < owned) { continue; }
+			is_ghost[contact >> 6] |= std::uint64_t(1) << (contact & 63);
+			boundary_owners.push_back(owner(contact));
+		}
+		if (boundary_owners.size() == found) { continue; }
+		std::sort(boundary_owners.begin() + found, boundary_owners.end());
+		boundary_owners.erase(std::unique(boundary_owners.begin() + found, boundary_owners.end()), boundary_owners.end());
+		boundary.push_back(static_cast<agent_id>(person));
+		boundary_starts.push_back(boundary_owners.size());
+	}
+
+	// ghosts are numbered after the owned agents in global order, each word of the
+	// bitmap keeps the number of ghosts before it
+	std::vector<agent_id> ghosts;
+	std::vector<std::uint32_t> ghosts_before(is_ghost.size());
+	for (size_t word = 0; word < is_ghost.size(); ++word) {
+		ghosts_before[word] = static_cast<std::uint32_t>(ghosts.size());
+		for (size_t bit = 0; bit < 64 && is_ghost[word] >> bit != 0; ++bit) {
+			if (is_ghost[word] >> bit & 1) { ghosts.push_back(static_cast<agent_id>(word * 64 + bit)); }
+		}
+	}
+
+	// this engine's id of any agent of the partition or a ghost
+	const size_t total_people = owned + ghosts.size();
+	auto local_id = [&](const agent_id person) {
+		if (person - first < owned) { return static_cast<agent_id>(person - first); }
+		const std::uint64_t below = is_ghost[person >> 6] & ((std::uint64_t(1) << (person & 63)) - 1);
+		return static_cast<agent_id>(owned + ghosts_before[person >> 6] + std::bitset<64>(below).count());
+	};
+
+	// set up the agents as init_spread_network would for their group sizes, then put
+	// every agent's own group in place
+	const size_t group_count = parameters.groups.size();
+	std::vector<size_t> sizes(group_count, 0);
+	std::vector<std::uint8_t> local_groups(total_people);
+	for (size_t person = 0; person < total_people; ++person) {
+		local_groups[person] = groups[person < owned ? first + person : ghosts[person - owned]];
+		if (local_groups[person] >= group_count) {
+			throw std::runtime_error("An agent's group is not one of the parameters'!");
+		}
+		++sizes[local_groups[person]];
+	}
+	group_sizes = sizes;
+	init_spread_network();
+	std::vector<agent_id>().swap(need_contacts);
+	local_groups.insert(local_groups.end(), kernel_padding, 0);
+	assign_groups(std::move(local_groups));
+
+	// a ghost only keeps its group, health and owned contacts, counters, frontier flags
+	// and compartments cover the owned agents
+	counter_stride = owned + kernel_padding;
+	std::vector<contact_count>(counter_groups * counter_stride, 0).swap(ill_contacts);
+	std::vector<std::uint64_t>((owned + 63) / 64, 0).swap(in_frontier);
+	if (!compact_compartments) {
+		susceptible_people.reset(owned);
+		infected_people.reset(owned);
+	}
+
+	// owned agents keep all their contacts, ghosts only list their owned contacts, found
+	// in a second pass over the owned agents' contacts
+	std::vector<contact_graph::edge_index> local_offsets(total_people + 1, 0);
+	for (size_t person = 0; person < owned; ++person) {
+		local_offsets[person + 1] = offsets[first + person + 1] - offsets[first + person];
+		for (contact_graph::edge_index slot = offsets[first + person]; slot < offsets[first + person + 1]; ++slot) {
+			if (neighbors[slot] - first >= owned) { ++local_offsets[local_id(neighbors[slot]) + 1]; }
+		}
+	}
+	for (size_t person = 0; person < total_people; ++person) { local_offsets[person + 1] += local_offsets[person]; }
+	std::vector<agent_id> local_neighbors(static_cast<size_t>(local_offsets[total_people]));
+	std::vector<contact_graph::edge_index> ghost_filled(ghosts.size(), 0);
+	for (size_t person = 0; person < owned; ++person) {
+		contact_graph::edge_index at = local_offsets[person];
+		for (contact_graph::edge_index slot = offsets[first + person]; slot < offsets[first + person + 1]; ++slot) {
+			const agent_id contact = local_id(neighbors[slot]);
+			local_neighbors[static_cast<size_t>(at++)] = contact;
+			if (contact >= owned) {
+				local_neighbors[static_cast<size_t>(local_offsets[contact] + ghost_filled[contact - owned]++)] =
+					static_cast<agent_id>(person);
+			}
+		}
+	}
+	std::shared_ptr<contact_graph> built = std::make_shared<contact_graph>();
+	built->assign(std::move(local_offsets), std::move(local_neighbors));
+	network = std::move(built);
+
+	// the threshold table is sized by the largest network of the whole run
+	widest_network = 0;
+	for (size_t person = 0; person < population; ++person) {
+		widest_network = std::max(widest_network, static_cast<size_t>(offsets[person + 1] - offsets[person]));
+	}
+
+	partition_starts.assign(starts.begin(), starts.end());
+	partition_index = index;
+	owned_last = static_cast<agent_id>(owned);
+	global_base = first;
+	whole_population = population;
+	halo = &channel;
+	ghost_ids.swap(ghosts);
+
+	boundary_ids.swap(boundary);
+	boundary_offsets.swap(boundary_starts);
+	boundary_partitions.swap(boundary_owners);
+	halo_outgoing.assign(partition_starts.size() - 1, std::vector<halo_update>());
+
+	// the counts only cover owned agents, the run adds up every partition's
+	std::fill(group_counts.begin(), group_counts.end(), 0);
+	for (agent_id person = 0; person < owned_last; ++person) {
+		if (!compact_compartments) { susceptible_people.insert(person); }
+		++group_counts[agent_group[person] * 3 + susceptible];
+	}
+
+	build_thresholds();
+}
+
+std::vector<std::uint32_t> spread_engine::partition_by_contacts(const size_t parts) const {
+	return cut_by_contacts(network->offset_array(), get_population(), parts);
+}
+
+void spread_engine::queue_halo(const int delta) {
+	if (halo == nullptr) { return; }
+	for (agent_id person : changed_people) {
+		const auto found = std::lower_bound(boundary_ids.begin(), boundary_ids.end(), person);
+		if (found == boundary_ids.end() || *found != person) { continue; }
+		const size_t i = static_cast<size_t>(found - boundary_ids.begin());
+		// the other partitions know the person by their global id
+		for (size_t j = boundary_offsets[i]; j < boundary_offsets[i + 1]; ++j) {
+			halo_outgoing[boundary_partitions[j]].push_back(halo_update{ global_id(person), delta });
+		}
+	}
+}
+
+void spread_engine::apply_halo(const halo_update& update) {
+	const auto found = std::lower_bound(ghost_ids.begin(), ghost_ids.end(), update.person);
+	if (found == ghost_ids.end() || *found != update.person) { return; }
+	const agent_id ghost = static_cast<agent_id>(owned_last + (found - ghost_ids.begin()));
+
+	// closing or reopening a contact of the ghost needs to know whether they are ill
+	health[ghost] = update.delta > 0 ? infected : removed;
+
+	// the ghost's contacts are all owned
+	contact_count* counters = ill_counters(agent_group[ghost]);
+	for (const agent_id& contact : network->contacts(ghost)) {
+		if (!is_open(contact)) { continue; }
+		counters[contact] = static_cast<contact_count>(counters[contact] + update.delta);
+		if (update.delta > 0) { mark_at_risk(contact); }
+	}
+}
+
+void spread_engine::exchange_halo() {
+	halo->exchange(halo_outgoing, halo_incoming);
+	for (std::vector<halo_update>& updates : halo_outgoing) { updates.clear(); }
+
+	// counter changes commute and prune_compartments sorts the frontier afterwards, so
+	// the order updates arrive in does not matter
+	for (const halo_update& update : halo_incoming) { apply_halo(update); }
+}
+
+void spread_engine::run_until(const size_t day) {
+
+	// events would index ghosts' counters, which a partition does not keep
+	if (halo != nullptr && mode != tick_mode::synchronous) {
+		throw std::logic_error("Partitioned engines can only tick synchronously!");
+	}
+	// daily modes just tick until the day is reached
+	if (mode != tick_mode::next_reaction) {
+		while (elapsed_days < day) { tick(); }
+		return;
+	}
+
+	// interventions change the hazards at the start of their day, so the events are run
+	// up to each intervention day in turn
+	while (elapsed_days < day) {
+		apply_due_interventions();
+		SPREAD_PROFILE_LAP(profile, interventions);
+		size_t stop = day;
+		if (next_intervention < interventions.size()) { stop = std::min(stop, interventions[next_intervention].day); }
+
+		if (!events_scheduled) { schedule_events(); }
+		SPREAD_PROFILE_LAP(profile, hazard_sweep);
+
+		// fire events in time order until the next one is on or after stop
+		while (!events.empty() && events.top_time() < static_cast<double>(stop)) {
+			fire_event(events.top(), events.top_time());
+		}
+		SPREAD_PROFILE_LAP(profile, transitions);
+
+		current_time = static_cast<double>(stop);
+		elapsed_days = static_cast<unsigned int>(stop);
+	}
+}
+
+double spread_engine::exponential_delay(const double rate) {
+	// a zero rate (beta or gamma set to 0) never fires
+	if (rate <= 0.0) { return std::numeric_limits<double>::infinity(); }
+	// and gamma set to 1 removes people the moment they fall ill
+	if (std::isinf(rate)) { return 0.0; }
+	SPREAD_PROFILE_COUNT(profile, rng_draws, 1);
+	return std::exponential_distribution<double>(rate)(event_rng);
+}
+
+void spread_engine::schedule_events() {
+
+	events.reset(get_population());
+	current_time = static_cast<double>(elapsed_days);
+
+	// make sure the frontier holds exactly the people at risk
+	prune_compartments();
+
+	// everyone infected gets a removal time, everyone at risk an infection time. The
+	// calendar leaves out removal days too far off to file, so the infected come from
+	// their compartment, or from health in a compact engine
+	if (compact_compartments) {
+		for (size_t i = 0; i < get_population(); ++i) {
+			if (health[i] != infected) { continue; }
+			events.schedule(static_cast<agent_id>(i), current_time + exponential_delay(removal_rate()));
+		}
+	}
+	for (agent_id person : infected_people) {
+		events.schedule(person, current_time + exponential_delay(removal_rate()));
+	}
+	for (agent_id person : at_risk_people) {
+		events.schedule(person, current_time + exponential_delay(infection_rate(person)));
+		set_listed_at_risk(person, false);
+	}
+
+	// the queue now stands in for the compartment vectors and calendar
+	removals.reset(elapsed_days);
+	at_risk_people.clear();
+	sorted_at_risk = 0;
+	events_scheduled = true;
+}
+
+void spread_engine::unschedule_events() {
+
+	events.reset(0);
+	removals.reset(elapsed_days);
+	at_risk_people.clear();
+
+	// scanning in agent_id order leaves the frontier sorted, removal days are
+	// drawn afresh, which is exact since they are memoryless
+	for (size_t i = 0; i < get_population(); ++i) {
+		const agent_id person = static_cast<agent_id>(i);
+		if (health[person] == infected) {
+			schedule_removal(person, removal_word(person));
+		}
+		else if (health[person] == susceptible && has_ill_contacts(person)) {
+			set_listed_at_risk(person, true);
+			at_risk_people.push_back(person);
+		}
+	}
+	sorted_at_risk = at_risk_people.size();
+	events_scheduled = false;
+}
+
+void spread_engine::reschedule_infection(const agent_id person, const double old_rate) {
+	const double new_rate = infection_rate(person);
+
+	// no ill contacts left, so no infection pending
+	if (new_rate <= 0.0) { events.cancel(person); }
+	// hazard just became positive, draw a fresh time (memoryless, so this is exact)
+	else if (old_rate <= 0.0 || !events.scheduled(person)) {
+		events.schedule(person, current_time + exponential_delay(new_rate));
+	}
+	// otherwise rescale the time left, the next-reaction method's reuse of its draw
+	else {
+		events.schedule(person, current_time + (old_rate / new_rate) * (events.time_of(person) - current_time));
+	}
+}
+
+void spread_engine::fire_event(const agent_id person, const double time) {
+
+	current_time = time;
+	SPREAD_PROFILE_COUNT(profile, agents_scanned, 1);
+	SPREAD_PROFILE_COUNT(profile, edges_touched, network->degree(person));
+
+	// a susceptible person's event is getting sick
+	if (health[person] == susceptible) {
+		move_compartment(person, susceptible, infected);
+		health[person] = infected;
+		move_count(person, susceptible, infected);
+
+		// their next event is removal
+		events.schedule(person, current_time + exponential_delay(removal_rate()));
+
+		// every susceptible contact's hazard goes up
+		contact_count* counters = ill_counters(agent_group[person]);
+		for (const agent_id& contact : network->contacts(person)) {
+			if (!is_open(contact)) { continue; }
+			const bool at_risk = health[contact] == susceptible;
+			const double old_rate = at_risk ? infection_rate(contact) : 0.0;
+			++counters[contact];
+			if (at_risk) { reschedule_infection(contact, old_rate); }
+		}
+	}
+
+	// an infected person's event is being removed
+	else {
+		move_compartment(person, infected, removed);
+		health[person] = removed;
+		move_count(person, infected, removed);
+
+		events.cancel(person);
+
+		// every susceptible contact's hazard goes down
+		contact_count* counters = ill_counters(agent_group[person]);
+		for (const agent_id& contact : network->contacts(person)) {
+			if (!is_open(contact)) { continue; }
+			const bool at_risk = health[contact] == susceptible;
+			const double old_rate = at_risk ? infection_rate(contact) : 0.0;
+			--counters[contact];
+			if (at_risk) { reschedule_infection(contact, old_rate); }
+		}
+	}
+}
@@ -3,9 +3,21 @@
 
 #include <vector>
 #include <random>
-#include <set>
 #include <algorithm>
 #include <iostream>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include "contact_graph.h"
+#include "worker_pool.h"
+#include "event_queue.h"
+#include "removal_calendar.h"
+#include "compartment_set.h"
+#include "spread_rng.h"
+#include "spread_parameters.h"
+#include "halo_channel.h"
+#include "contact_classes.h"
+#include "tick_profile.h"
 
 
 /**
@@ -14,27 +26,73 @@
 visualization, including configuring the networks for each person, calculating infections,
 and calculating removals.
 
-The spread_engine class stores several static constexpr values which correspond to 
+The spread_engine class stores a spread_parameters set which corresponds to 
 experimental values for calculating spread as wellas network sizes for each person. 
-In addition, it stores values corresponding to the S,I, and R values for morons and 
-normal people, and vectors for looping through each of those groups, as well.
+In addition, it stores values corresponding to the S,I, and R values of every group
+of people (normal people and morons by default), and vectors for looping through
+each compartment, as well.
+
+People are not stored as individual objects. Each person is a 32 bit agent_id which
+indexes a set of contiguous struct-of-arrays vectors (agent_group, one ill contact
+counter array per group), all owned by the engine and released when it is destroyed
+or re-initialized. The contact network is held in a CSR contact_graph built once by
+populate_spread_network.
 
 For its functions, it has getters which return S,I, and R values and days elapsed 
 since the start of the simulation, and several initializer and step functions.
 */
 class spread_engine
 {
-private:
-	// the hazard rate of getting COVID-19 per day when interacting with a sick person
-	static constexpr double beta = 0.02;
-	// the risk reduction factor experienced by those interacting with someone wearing a mask
-	static constexpr double mu = 0.34;
-	// the daily rate people recover/die from the ill state and move into the removed group
-	static constexpr double gamma = 1.0/14.0;
+public:
+	/**
+	@enum tick_mode
+	@brief How tick() advances the simulation by one day.
+
+	immediate is the original single-threaded sweep, where someone who gets sick updates
+	their contacts straight away, so later people in the same sweep already see them.
+
+	synchronous decides every transition of the day against a frozen snapshot of the
+	ill contact counters in parallel, then applies all counter changes as one batched
+	scatter. A given seed gives the same results whatever the thread count.
+
+	next_reaction drops the daily time step and runs the epidemic in continuous time
+	with the next-reaction method: every at-risk or infected agent has one pending event
+	(getting sick at rate eta, being removed at rate gamma) in an indexed event queue,
+	and only agents whose hazard changed are rescheduled. Cost is proportional to the
+	number of events rather than population x days.
+
+	tau_leap is an approximate mode for screening very large populations on
+	configuration networks: init_spread_network sets up no agents and no network, only
+	counts of susceptible people by contact class, and each day draws binomial numbers
+	of infections and removals per class (see contact_classes.h for the model and its
+	error bound). Cost per day does not depend on the population, which may be larger
+	than 32 bit agent ids allow. It must be chosen before init_spread_network.
+	*/
+	enum class tick_mode { immediate, synchronous, next_reaction, tau_leap };
 
-	// number contacts for normal people and morons
-	static constexpr size_t normal_contacts = 9;
-	static constexpr size_t moron_contacts = 20;
+	/**
+	@enum propagation
+	@brief How a synchronous tick brings the ill contact counters up to date with the
+	day's infections and removals.
+
+	push adds +1 or -1 to the counters of every contact of everyone who changed state,
+	which is cheap while few people change state a day.
+
+	pull recounts the ill contacts of every susceptible person from a bitmap of who is
+	infected, one bit per agent, so its cost follows the susceptible population rather
+	than the day's changes, and it reads contacts front to back instead of writing
+	counters all over memory. It wins around the peak, when the day's changes have more
+	contacts than a fraction of the susceptible population, as direction-optimizing BFS
+	switches to bottom-up search when the frontier grows.
+
+	automatic picks whichever of the two is cheaper each tick. Both give the same
+	counters, so the choice never changes results.
+	*/
+	enum class propagation { automatic, push, pull };
+
+private:
+	// beta, gamma and the contact number and mask factor of every group
+	spread_parameters parameters;
 
 	// number days elapsed since starting simulation
 	unsigned int elapsed_days;
@@ -42,43 +100,649 @@ private:
 	// number of people initially sick
 	size_t initial_sick;
 
-	// tracking variables for normal people
-	size_t total_normal;
-	size_t susceptible_normal;
-	size_t infected_normal;
-	size_t removed_normal;
+	// number of people in each group, set before init_spread_network
+	std::vector<size_t> group_sizes;
+
+	// agents are referred to by their index into the per-agent arrays below
+	using agent_id = contact_graph::agent_id;
+	// ill contact counters never exceed a person's network size
+	using contact_count = std::uint16_t;
+
+	// placeholder id for a vacated slot in one of the agent_id vectors
+	static constexpr agent_id no_agent = std::numeric_limits<agent_id>::max();
 
-	// tracking variables for morons
-	size_t total_moron;
-	size_t susceptible_moron;
-	size_t infected_moron;
-	size_t removed_moron;
+	// the hazard kernel reads whole 32 bit words around each agent's entry, so the arrays
+	// it gathers from carry this many unused entries past the last agent
+	static constexpr size_t kernel_padding = 4;
 
-	// detailed documentation in spread_engine.cpp
-	struct person;
+	// per-agent attributes, indexed by agent_id
+	// group of each agent, 0 for normal people and 1 for morons by default, followed by
+	// kernel_padding zeros. It never changes once set up, so replicates of a run share it
+	// like the network rather than copy it
+	std::shared_ptr<const std::vector<std::uint8_t>> group_storage;
+	// group_storage's entries, read by every tick
+	const std::uint8_t* agent_group;
+
+	/**
+	@brief Makes groups the agent groups of this engine
+	@param groups has one entry per agent followed by kernel_padding zeros
+	*/
+	void assign_groups(std::vector<std::uint8_t>&& groups) {
+		group_storage = std::make_shared<const std::vector<std::uint8_t>>(std::move(groups));
+		agent_group = group_storage->data();
+	}
+	// number of groups the per-agent arrays are laid out for
+	size_t counter_groups;
+	// length of each group's counter array, the population plus kernel_padding (only the
+	// owned agents of a partition, whose ghosts need no counters)
+	size_t counter_stride;
+	// ill_contacts[h * counter_stride + agent] is the number of ill contacts of group h in
+	// agent's network, one array per group back to back so each sweep reads contiguous counters.
+	// Only susceptible agents' counters are ever read, and a pull only recounts theirs
+	std::vector<contact_count> ill_contacts;
+
+	/**
+	Counter array of one group
+	@param group is the group of the ill contacts counted
+	@return is a pointer to the group's counter of agent 0
+	*/
+	contact_count* ill_counters(const size_t group) { return ill_contacts.data() + group * counter_stride; }
+	const contact_count* ill_counters(const size_t group) const { return ill_contacts.data() + group * counter_stride; }
+	// each agent's contacts based on configuration network, read by every tick, it is
+	// immutable once built so replicates of a run share it rather than copy it
+	std::shared_ptr<const contact_graph> network;
 	 
-	// vector declaration for people without a network,
+	// one entry (stub) per contact still needed by each person,
 	// gets cleared after all networks are configured
-	std::vector<person*> need_contacts;
+	std::vector<agent_id> need_contacts;
+
+	// health of each agent, indexed by agent_id
+	enum health_state : std::uint8_t { susceptible, infected, removed };
+	std::vector<std::uint8_t> health;
+
+	// S, I and R counts of every group, group_counts[group * 3 + health_state]
+	std::vector<size_t> group_counts;
+
+	/**
+	@brief Moves one person's group count from one compartment to another
+	@param person is the agent changing state
+	@param from is the state they leave
+	@param to is the state they enter
+	*/
+	void move_count(const agent_id person, const health_state from, const health_state to) {
+		const size_t group = agent_group[person];
+		--group_counts[group * 3 + from];
+		++group_counts[group * 3 + to];
+	}
+
+	/**
+	Sums one compartment over every group
+	@param state is the compartment
+	@return is a size_t corresponding to the number of people in it
+	*/
+	size_t total_in(const health_state state) const;
+
+	/**
+	Checks whether anyone in a person's network is ill
+	@param person is the agent
+	@return is true if any of their ill contact counters is above 0
+	*/
+	bool has_ill_contacts(const agent_id person) const {
+		// every counter is read rather than stopping at the first ill one, which group
+		// that is varies from person to person and a branch on it mispredicts
+		const contact_count* counters = ill_contacts.data() + person;
+		// the default two groups are spelled out, this runs for every frontier member every day
+		if (counter_groups == 2) { return (counters[0] | counters[counter_stride]) > 0; }
+		contact_count any = 0;
+		for (size_t h = 0; h < counter_groups; ++h) { any |= counters[h * counter_stride]; }
+		return any > 0;
+	}
+
+	// everyone susceptible and everyone infected, kept exact on every transition in
+	// every mode, so a tick only pays for the people changing state. Compact engines
+	// leave both empty and scan health on the rare occasions they need the lists
+	compartment_set susceptible_people;
+	compartment_set infected_people;
+	bool compact_compartments;
+
+	/**
+	@brief Moves a person between the compartment sets, unless the engine is compact
+	@param person is the agent changing state
+	@param from is the state they leave, susceptible or infected
+	@param to is the state they enter, infected or removed
+	*/
+	void move_compartment(const agent_id person, const health_state from, const health_state to) {
+		if (compact_compartments) { return; }
+		if (from == susceptible) { susceptible_people.erase(person); }
+		else { infected_people.erase(person); }
+		if (to == infected) { infected_people.insert(person); }
+	}
+
+	// every infected person filed under the day they will be removed, drawn once
+	// when they get sick, so a day's removals only touch the people leaving
+	removal_calendar removals;
+
+	// frontier of susceptible people with at least one ill contact, the only people an
+	// infection sweep needs to look at. Entries whose contacts have all been removed
+	// are dropped lazily by the next sweep. It is kept sorted by agent_id after each
+	// prune so that sweeps read the per-agent arrays in memory order
+	std::vector<agent_id> at_risk_people;
+	// length of the sorted prefix of at_risk_people, newcomers are appended after it
+	size_t sorted_at_risk;
+	// one bit per owned agent, set while they are listed in at_risk_people. Threads only
+	// write the flags of chunks and scatter blocks, which cover whole words
+	std::vector<std::uint64_t> in_frontier;
+
+	/**
+	Checks whether a person is listed in at_risk_people
+	@param person is the agent
+	@return is true if their frontier flag is set
+	*/
+	bool listed_at_risk(const agent_id person) const { return in_frontier[person >> 6] >> (person & 63) & 1; }
+
+	/**
+	Sets or clears a person's frontier flag
+	@param person is the agent
+	@param listed is whether they are listed in at_risk_people
+	*/
+	void set_listed_at_risk(const agent_id person, const bool listed) {
+		const std::uint64_t bit = std::uint64_t(1) << (person & 63);
+		in_frontier[person >> 6] = listed ? in_frontier[person >> 6] | bit : in_frontier[person >> 6] & ~bit;
+	}
+
+	/**
+	@brief Adds person to at_risk_people if they are susceptible and not already in it
+	@param person is an agent who just gained an ill contact
+	*/
+	void mark_at_risk(const agent_id person);
+
+	/**
+	@brief Drops people from at_risk_people who are no longer susceptible or have no
+	ill contacts left, and merges newcomers into its sorted order
+	*/
+	void prune_compartments();
+
+	/**
+	@brief Files a newly infected person in the removal calendar. Being removed with
+	probability gamma each day (including the day of infection) makes the number of
+	days until removal geometric, so it is drawn once here by inverting the geometric
+	distribution: k = floor(log(u) / log(1 - gamma))
+	@param person is the newly infected agent
+	@param word is a random 32 bit word reserved for this draw
+	*/
+	void schedule_removal(const agent_id person, const std::uint32_t word);
+
+	/**
+	Draws the random word for a removal day, from immediate_rng in tick_mode::immediate and
+	from the (seed, day, agent_id) stream otherwise
+	@param person is the newly infected agent
+	@return is a std::uint32_t corresponding to the word
+	*/
+	std::uint32_t removal_word(const agent_id person);
+
+	// seed that network generation, initial infections and synchronous draws derive from
+	std::uint64_t seed;
+
+	// generator for anything drawn in a fixed order, each use gets its own jump-ahead substream
+	using sequential_rng = xoshiro256ss;
+	// counter-based generator for per-agent draws that may happen on any thread
+	using draw_stream = philox_stream;
+
+	// substreams of the seed for the sequential generators
+	enum rng_substream : size_t { network_substream = 0, initial_substream = 1, event_substream = 2, immediate_substream = 3,
+		class_substream = 4 };
+
+	// generator behind random() and tick_mode::immediate, reseeded with the seed
+	sequential_rng immediate_rng;
+
+	// raw 32 bit word from immediate_rng
+	std::uint32_t immediate_word() {
+		SPREAD_PROFILE_COUNT(profile, rng_draws, 1);
+		return static_cast<std::uint32_t>(immediate_rng() >> 32);
+	}
+
+	// how tick() advances the simulation
+	tick_mode mode;
+
+	// how synchronous ticks update the ill contact counters
+	propagation direction;
+
+	// measured costs for choosing between push and pull, in pulled contacts: a pushed
+	// contact costs this many, and the pass building the bitmap one per 2^shift agents
+	static constexpr size_t pushed_contact_cost = 2;
+	static constexpr size_t pull_agent_cost_shift = 5;
+
+	// threads synchronous ticks split their sweeps across
+	worker_pool workers;
+
+	// synchronous ticks sweep compartment vectors in chunks of this many entries
+	static constexpr size_t chunk_size = size_t(1) << 14;
+
+	// per-chunk positions of the people who change state this tick, reused between ticks
+	std::vector<std::vector<std::uint32_t>> chunk_transitions;
+
+	// per-chunk random words and decisions for the people being decided, reused between ticks
+	std::vector<std::vector<std::uint32_t>> chunk_words;
+	std::vector<std::vector<std::uint8_t>> chunk_decisions;
+
+	// removal words for the people infected in a synchronous tick
+	std::vector<std::uint32_t> removal_words;
+
+	// everyone who changed state in the current phase of a synchronous tick
+	std::vector<agent_id> changed_people;
+
+	// agents whose counters get scattered to together, 2^16 agents keep a block's
+	// counters within a core's cache
+	static constexpr size_t scatter_block_bits = 16;
+
+	// delta buffers for the scatter: scatter_buffers[part][block * groups + source group]
+	// lists the contacts in block whose counters change, reused between ticks
+	std::vector<std::vector<std::vector<agent_id>>> scatter_buffers;
+
+	// per-block lists of people who joined the frontier during a scatter
+	std::vector<std::vector<agent_id>> scatter_at_risk;
+
+	// bit a % 64 of infected_bits[a / 64] is set if agent a is infected, rebuilt by each
+	// pull and each time contacts close or reopen
+	std::vector<std::uint64_t> infected_bits;
+
+	/**
+	@brief Rebuilds infected_bits from health
+	*/
+	void build_infected_bits();
+
+	// per-chunk lists of the people a pull found at risk, reused between ticks
+	std::vector<std::vector<agent_id>> chunk_at_risk;
+
+	// a mapped network is scattered from in windows of about this many bytes of contacts,
+	// big enough for the disk to stream, small enough that two windows fit in memory
+	static constexpr size_t scatter_window_bytes = size_t(64) << 20;
+
+	// positions in changed_people where each scatter window ends, reused between ticks
+	std::vector<size_t> scatter_windows;
+
+	// bytes of a mapped network's contacts that may stay in memory, windows are
+	// dropped once scattered from when the contacts are larger than this
+	size_t graph_cache_bytes;
+
+	// hazard_weights[g * groups + h] = mixing(g, h) * mask of group h, the weight of one
+	// ill contact of group h in the hazard of a susceptible agent of group g
+	std::vector<double> hazard_weights;
+
+	// no ill contact counter can exceed the largest network size, so counts run from 0
+	// to threshold_stride - 1
+	size_t threshold_stride;
+
+	// tables with more entries than this are not built, 2^16 keeps one in a core's cache
+	static constexpr size_t max_threshold_entries = size_t(1) << 16;
+
+	// infection_thresholds[threshold_index(agent)] is the chance of getting sick today
+	// with the agent's group and ill contact counts, scaled to 2^32, so each decision is
+	// one raw 32 bit random word compared against an integer. It has
+	// groups * threshold_stride^groups entries, so it is only built for few groups and
+	// small networks and is left empty otherwise
+	std::vector<std::uint32_t> infection_thresholds;
+
+	// survival_factors[(g * groups + h) * threshold_stride + c] = e^(-beta * hazard weight * c),
+	// the chance that an agent of group g does not get sick today from c ill contacts of
+	// group h. Without a threshold table a day's chance of staying healthy is the
+	// product of one factor per group, which the hazard kernel computes
+	std::vector<double> survival_factors;
+
+	// log(1 - gamma), the log of the chance of staying infected for another day
+	double removal_log_survival;
+
+	/**
+	@brief Rebuilds hazard_weights, infection_thresholds, survival_factors and
+	removal_log_survival from the parameters, the mask scales and the largest network
+	size, must be called whenever any of them change
+	*/
+	void build_thresholds();
+
+	// interventions given to set_interventions, sorted by day, and the first one not applied yet
+	std::vector<intervention> interventions;
+	size_t next_intervention;
+
+	// contact shares and mask scales in force, see intervention, empty while every
+	// contact is open and every scale is 1
+	std::vector<double> contact_share;
+	std::vector<double> mask_scale;
+
+	// bit s % 64 of closed_contacts[s / 64] is set if the contact at slot s of the
+	// network's neighbor array is closed, empty while every contact is open. Both ends of
+	// a contact are always open or closed together
+	std::vector<std::uint64_t> closed_contacts;
+	// the bitmap being built while contacts close or reopen, reused between interventions
+	std::vector<std::uint64_t> next_closed;
+
+	// contacts are closed and reopened in chunks of this many slots, a multiple of 64 so
+	// no two chunks write the same word of the bitmap
+	static constexpr size_t closing_chunk = size_t(1) << 20;
+
+	/**
+	Checks whether a contact is open, every loop over a person's contacts skips the
+	closed ones
+	@param contact is an entry of the network's neighbor array, not a copy of one
+	@return is true if the contact is open
+	*/
+	bool is_open(const agent_id& contact) const {
+		if (closed_contacts.empty()) { return true; }
+		const size_t slot = static_cast<size_t>(&contact - network->neighbor_array());
+		return !(closed_contacts[slot >> 6] >> (slot & 63) & 1);
+	}
+
+	/**
+	@brief Checks an intervention against the groups of the parameters
+	@param change is the intervention
+	@throws std::logic_error if a share is outside [0, 1] or a scale is negative, the
+	share matrix is not groups x groups or not symmetric, or there is not one scale per group
+	*/
+	void check_intervention(const intervention& change) const;
+
+	/**
+	@brief Redraws which contacts are closed under contact_share, then brings the ill
+	contact counters of every owned susceptible person in line with it: each of their
+	contacts that closed or reopened while ill takes one off or adds one to their
+	counter of its group. Only contacts that changed are touched, so nobody's counters
+	are recounted. People who gain an ill contact join the frontier, those left without
+	one leave it
+	*/
+	void update_closed_contacts();
+
+	/**
+	@brief Applies every intervention whose day has come, in order
+	*/
+	void apply_due_interventions();
+
+	/**
+	@brief Builds the network of parameters.topology with network_generators.h on the
+	engine's threads, for every model but the configuration network
+	@throws std::length_error if an agent ends up with more contacts than the ill
+	contact counters can hold
+	*/
+	void generate_topology();
+
+	/**
+	Position of a susceptible person in infection_thresholds
+	@param person is the susceptible agent
+	@return is a size_t corresponding to group * threshold_stride^groups plus their
+	ill contact counts read as digits in base threshold_stride
+	*/
+	size_t threshold_index(const agent_id person) const {
+		const contact_count* counters = ill_contacts.data() + person;
+		size_t index = agent_group[person];
+		if (counter_groups == 2) {
+			return (index * threshold_stride + counters[0]) * threshold_stride + counters[counter_stride];
+		}
+		for (size_t h = 0; h < counter_groups; ++h) {
+			index = index * threshold_stride + counters[h * counter_stride];
+		}
+		return index;
+	}
+
+	/**
+	Hazard rate of a susceptible person getting sick in the next-reaction mode
+	@param person is the susceptible agent
+	@return is a double corresponding to eta = beta * sum of weight * ill contacts over groups
+	*/
+	double infection_rate(const agent_id person) const;
+
+	/**
+	Decides one susceptible person's infection from their survival factors, the scalar
+	form of the hazard kernel
+	@param person is the susceptible agent
+	@param word is the random 32 bit word reserved for the decision
+	@return is true with probability 1 - e^(-eta * delta_t)
+	*/
+	bool kernel_decision(const agent_id person, const std::uint32_t word) const;
+
+	/**
+	Decides one susceptible person's infection today, from the threshold table when
+	there is one
+	@param person is the susceptible agent
+	@param word is the random 32 bit word reserved for the decision
+	@return is true with probability 1 - e^(-eta * delta_t)
+	*/
+	bool infection_decision(const agent_id person, const std::uint32_t word) const {
+		if (infection_thresholds.empty()) { return kernel_decision(person, word); }
+		return word < infection_thresholds[threshold_index(person)];
+	}
+
+	/**
+	@brief Decides the infections of a block of susceptible people, with the threshold
+	table when there is one and otherwise with the hazard kernel, which multiplies
+	each person's survival factors four people at a time with AVX2 when the build
+	enables it (__AVX2__), and one at a time otherwise. Both kernels give the same answers
+	@param people are the susceptible agents
+	@param words are their random words
+	@param count is the number of agents
+	@param sick receives 1 for everyone who gets sick and 0 for the rest
+	*/
+	void decide_infections(const agent_id* people, const std::uint32_t* words, const size_t count, std::uint8_t* sick) const;
+
+	// pending infection or removal of every agent in the next-reaction mode
+	event_queue events;
+	// true while the compartments are run by events rather than by the vectors above,
+	// which are left empty until a daily tick rebuilds them
+	bool events_scheduled;
+	// continuous time reached by the next-reaction mode, in days
+	double current_time;
+	// generator for event delays, seeded from the run's seed by set_seed and
+	// init_spread_network and never reseeded in between, so delays drawn after an
+	// intervention or mode switch are independent of the earlier ones
+	sequential_rng event_rng;
+
+	// counts of susceptible people by contact class, standing in for the agents in tau_leap mode
+	contact_classes classes;
+	// true if init_spread_network set up classes rather than agents
+	bool class_population;
+
+	// time and work of every tick, only recorded when built with SPREAD_PROFILE
+	tick_profile profile;
+
+	/**
+	@brief Moves the engine onto the event queue: schedules a removal for everyone
+	infected and an infection for everyone at risk, both memoryless, so this can
+	happen at any point of a run
+	*/
+	void schedule_events();
+
+	/**
+	@brief Moves the engine back onto the daily compartment vectors by rebuilding
+	the removal calendar and at_risk_people from health
+	*/
+	void unschedule_events();
+
+	/**
+	@brief Makes one agent's pending event happen and reschedules its contacts
+	@param person is the agent whose event fires
+	@param time is when it fires
+	*/
+	void fire_event(const agent_id person, const double time);
+
+	/**
+	@brief Reschedules a susceptible person's infection after their hazard changed,
+	rescaling the time left by old_rate / new rate as the next-reaction method does
+	@param person is the susceptible agent
+	@param old_rate is their hazard before the change
+	*/
+	void reschedule_infection(const agent_id person, const double old_rate);
+
+	/**
+	Draws an exponentially distributed delay
+	@param rate is the hazard rate, 0 never fires and infinity fires at once
+	@return is a double corresponding to the delay in days
+	*/
+	double exponential_delay(const double rate);
+
+	/**
+	Hazard rate of removal that gives the daily modes' chance gamma of being removed
+	within a day, -log(1 - gamma), the same conversion the infection chances make the
+	other way. Read from build_thresholds
+	@return is a double corresponding to the rate per day, infinite for gamma 1
+	*/
+	double removal_rate() const { return -removal_log_survival; }
+
+	/**
+	@brief Splits people into chunks across the worker threads and moves everyone who
+	gets sick out of people and into changed_people, in chunk order. Each chunk first
+	fills a buffer with its agents' words from draws, then decides them all with
+	decide_infections
+	@param people is the frontier being swept, it is not written while deciding so
+	every decision sees the same snapshot
+	@param draws is the stream the agents' random words come from
+	*/
+	void decide_in_chunks(std::vector<agent_id>& people, const draw_stream& draws);
+
+	/**
+	@brief Adds delta to the ill contact counters of every contact of changed_people.
+	Updates are first bucketed by the block of the contact being updated, then each
+	block's buckets are applied by one thread, so counter writes stay cache local
+	and no two threads write the same counter.
+
+	With a mapped network changed_people is sorted first and its contacts are read in
+	windows of ascending agent ids, so the file is read front to back. The next
+	window is read ahead while the current one is bucketed, and windows already read
+	are dropped when the network is larger than graph_cache_bytes
+	@param delta is +1 for people who just got sick, -1 for people just removed
+	*/
+	void scatter_contacts(const int delta);
+
+	/**
+	Checks whether today's counter updates are cheaper pulled than pushed. A pushed
+	contact is bucketed, then updates a counter somewhere in memory, a pulled one is read
+	in order and looked up in the bitmap, so a tick pulls once the day's changes have
+	enough contacts to outweigh the susceptible population's plus the bitmap's pass
+	@param changed_slots is the number of contacts of everyone who changes state today
+	@return is true if this tick should pull, see propagation
+	*/
+	bool should_pull(const size_t changed_slots) const;
+
+	/**
+	@brief Recounts the ill contacts of every susceptible person from infected_bits and
+	rebuilds at_risk_people from the people with any. Agents are swept in agent_id
+	order, so contacts are read front to back and the frontier comes out sorted
+	*/
+	void pull_contacts();
+
+	/**
+	@brief Advances one day in tick_mode::synchronous
+	*/
+	void synchronous_tick();
+
+	// agents below owned_last are simulated by this engine, everyone unless own_agents or
+	// load_partition made it one partition of a run spread over several processes. A
+	// partition numbers its own agents from 0 and its ghosts after them
+	agent_id owned_last;
+
+	// global id of this engine's agent 0, 0 unless the engine is a partition, whose own
+	// agents are a contiguous range of the population
+	agent_id global_base;
+	// population of the whole run, which a partition only holds part of
+	size_t whole_population;
+	// largest network of the whole run, the threshold table of a partition is sized by
+	// it so every partition decides infections the same way one engine would
+	size_t widest_network;
+
+	/**
+	Global id of an agent, which draws and the contacts an intervention closes are keyed by
+	@param person is the agent's id in this engine
+	@return is the agent's id in the whole population
+	*/
+	agent_id global_id(const agent_id person) const {
+		return person < owned_last ? person + global_base : ghost_ids[person - owned_last];
+	}
+
+	/**
+	Checks whether an agent is simulated by this engine
+	@param person is the agent
+	@return is true if person is in the owned range
+	*/
+	bool owns(const agent_id person) const {
+		return person < owned_last;
+	}
+
+	// first agent of every partition followed by the population, empty when not partitioned
+	std::vector<agent_id> partition_starts;
+	// position of this engine's partition in partition_starts
+	size_t partition_index;
+	// carries halo updates to and from the other partitions, not owned by the engine
+	halo_channel* halo;
+
+	// ghosts are agents owned elsewhere with contacts in this partition, they are this
+	// engine's agents from owned_last on, and their contacts in the network are only
+	// their owned contacts. ghost_ids holds their global ids, sorted
+	std::vector<agent_id> ghost_ids;
+
+	// boundary agents are owned agents with ghost contacts. boundary_ids is sorted,
+	// and the partitions holding contacts of boundary_ids[i] are
+	// boundary_partitions[boundary_offsets[i]] up to boundary_partitions[boundary_offsets[i + 1]]
+	std::vector<agent_id> boundary_ids;
+	std::vector<size_t> boundary_offsets;
+	std::vector<std::uint32_t> boundary_partitions;
 
-	// vector declarations for people types
-	std::vector<person*> all_people;
-	std::vector<person*> susceptible_people;
-	std::vector<person*> infected_people;
+	// updates gathered during a tick for each partition, and those received, reused between ticks
+	std::vector<std::vector<halo_update>> halo_outgoing;
+	std::vector<halo_update> halo_incoming;
+
+	/**
+	@brief Makes this engine one partition of a population whose network is given as
+	raw CSR arrays: the owned agents and their ghosts get this engine's own ids, the
+	network is rebuilt over them, and every per-agent array only covers them
+	@param offsets are the population + 1 CSR offsets of the whole network
+	@param neighbors are its contacts
+	@param groups is the group of every agent of the population
+	@param population is the number of agents of the whole network
+	@param starts holds the first agent of every partition followed by the population
+	@param index is the partition this engine simulates
+	@param channel carries the halo updates
+	@throws std::logic_error if the mode is not synchronous or the partitions do not
+	cover the population in order
+	@throws std::runtime_error if an agent's group is not one of the parameters'
+	*/
+	void build_partition(const contact_graph::edge_index* offsets, const agent_id* neighbors, const std::uint8_t* groups,
+		const size_t population, const std::vector<std::uint32_t>& starts, const size_t index, halo_channel& channel);
+
+	/**
+	@brief Queues a halo update for every boundary agent in changed_people
+	@param delta is +1 for people who just got sick, -1 for people just removed
+	*/
+	void queue_halo(const int delta);
+
+	/**
+	@brief Applies a change of a ghost to the counters of their owned contacts, who
+	join the frontier if they gained an ill contact while susceptible. The ghost's
+	health is kept as well, closing or reopening a contact needs it
+	@param update is the ghost and their change
+	*/
+	void apply_halo(const halo_update& update);
+
+	/**
+	@brief Sends the queued halo updates to the other partitions and applies the ones
+	they sent here
+	*/
+	void exchange_halo();
 
 	// we don't need to keep track of removed people,
 	// since they are now removed from the sim
-	//std::vector<person*> removed_people;
+	//std::vector<agent_id> removed_people;
 
 	
 
 public:
 
 	// default constructor simply initializes all size_ts stored privately to 0
+	// and picks a seed from std::random_device
 	spread_engine();
-	// default destructor
+	// default destructor, per-agent storage is released by the owning vectors
 	~spread_engine();
 
+	/**
+	Returns the number of agents currently held by the engine
+	@return is a size_t corresponding to the simulated population
+	*/
+	const size_t get_population() const;
+
 	/**
 	Returns random number within arg-specified interval
 	
@@ -90,11 +754,128 @@ public:
 	@tparam from is the lower bound of the desired output
 	@tparam to is the upper bound of the desired output
 	@treturn is a variable type corresponding to the input type
-	that is a random number between the to and from arguments
+	that is a random number between the to and from arguments,
+	drawn from the engine's generator so it follows the seed too
 	*/
-	template<typename Numeric, typename Generator = std::mt19937>
+	template<typename Numeric>
 	Numeric random(Numeric from, Numeric to);
 
+	/**
+	Sets the seed of the run, a given seed always generates the same network,
+	initial infections and epidemic curve in every tick_mode
+	@param new_seed is the seed, call before init_spread_network
+	*/
+	void set_seed(const std::uint64_t new_seed);
+
+	/**
+	Getter for the seed of the run
+	@return is a std::uint64_t corresponding to the seed
+	*/
+	std::uint64_t get_seed() const;
+
+	/**
+	Sets how many threads synchronous ticks use, results do not depend on it
+	@param threads is the total number of threads including the caller
+	*/
+	void set_threads(const size_t threads);
+
+	/**
+	Sets how much of a mapped network may stay in memory. Networks loaded with
+	load_network can be larger than physical memory, if their contacts are larger
+	than this, synchronous ticks drop every part of the file they are done with so
+	the operating system never has to choose between it and the per-agent arrays.
+	Unlimited by default, the operating system then evicts pages on its own
+	@param bytes is the budget in bytes
+	*/
+	void set_graph_cache(const size_t bytes);
+
+	/**
+	Sets how tick() advances the simulation, tick_mode::immediate by default. Set it
+	before randomly_infect_healthy so that the initial infections' removal days are
+	drawn from the seeded streams as well
+	@param new_mode is the tick_mode to use from the next tick on
+	@throws std::logic_error if the engine holds a partition and new_mode is not
+	tick_mode::synchronous
+	*/
+	void set_tick_mode(const tick_mode new_mode);
+
+	/**
+	Sets how synchronous ticks update the ill contact counters, propagation::automatic
+	by default. Results do not depend on it. Partitioned engines always push, their
+	ghosts' states only arrive as halo updates
+	@param new_direction is the propagation to use from the next tick on
+	*/
+	void set_propagation(const propagation new_direction);
+
+	/**
+	Makes the engine keep no susceptible and infected lists, for replicates of an
+	ensemble, which then only hold their health, ill contact counters and frontier flags
+	per agent. Ticks are unchanged, but randomly_infect_healthy and the start of a
+	next_reaction run scan every agent's health instead, so the order the events are
+	drawn in, and hence a next_reaction run, differs from a non-compact engine's. Takes
+	effect when the population is next set up (init_spread_network, load_network or
+	share_network), off by default
+	@param compact is true to drop the lists
+	*/
+	void set_compact_compartments(const bool compact);
+
+	/**
+	Sets beta, gamma, the groups' contact numbers and mask factors and the network
+	topology. The rates take effect from the next tick, the contact numbers and topology
+	from the next populate_spread_network (init_spread_network in tau_leap mode), and
+	the number of groups must stay the same once a population is set up
+	@param new_parameters is the parameter set to use
+	@throws std::logic_error if a rate, mask or mixing entry is negative, gamma or the
+	rewiring probability is above 1, a household or workplace is empty, the mixing matrix is not groups x groups, or the number of groups changes under
+	an existing population
+	@throws std::length_error if there are no groups or more than 255, or a contact
+	number (or a small-world ring) does not fit the ill contact counters
+	*/
+	void set_parameters(const spread_parameters& new_parameters);
+
+	/**
+	Getter for the parameter set in use
+	@return is a const spread_parameters& corresponding to the current parameters
+	*/
+	const spread_parameters& get_parameters() const;
+
+	/**
+	Sets the interventions of the run, each applied by tick() before the day it names,
+	so one network can be run under any number of intervention timelines. Contacts are
+	closed and reopened in place, with no new network. Interventions whose day has
+	passed are applied at the next tick, and init_spread_network (or loading or sharing
+	a network) starts the timeline over with every contact open
+	@param timeline holds the interventions in any order, those of one day are applied
+	in the order given
+	@throws std::logic_error if an intervention does not fit the groups, see intervention
+	*/
+	void set_interventions(const std::vector<intervention>& timeline);
+
+	/**
+	Applies an intervention straight away, whatever its day. Closing or reopening
+	contacts costs one pass over the network, only the counters of susceptible people
+	with an ill contact that closed or reopened change. In tick_mode::next_reaction the
+	pending events are redrawn from the new hazards, which is exact as they are memoryless
+	@param change is the intervention
+	@throws std::logic_error if the intervention does not fit the groups, or closes
+	contacts of tau_leap contact classes, which have no contacts to close
+	*/
+	void apply_intervention(const intervention& change);
+
+	/**
+	Getter for the time each tick spent in its phases and the agents, contacts and draws
+	it went through, one row per tick() since the last clear_profile. Only recorded when
+	the engine is built with SPREAD_PROFILE defined, otherwise it stays empty and ticks
+	carry no instrumentation at all (see tick_profile.h)
+	@return is a const tick_profile& whose records or write_csv give the table
+	*/
+	const tick_profile& get_profile() const;
+
+	/**
+	Empties the table of get_profile
+	*/
+	void clear_profile();
+
 	/**
 	Getter for returning days since start of sim
 	@return is a size_t corresponding to days since start of sim
@@ -102,40 +883,81 @@ public:
 	const size_t get_days_elapsed() const;
 
 	/**
-	Getter for returning number of susceptible normal people
+	Getter for the number of groups
+	@return is a size_t corresponding to the number of groups in the parameters
+	*/
+	const size_t get_group_count() const;
+
+	/**
+	Getter for returning number of susceptible people in a group
+	@param group is the group
+	@return is a size_t corresponding to number of susceptible people in it
+	*/
+	const size_t get_susceptible(const size_t group) const;
+	/**
+	Getter for returning number of infected people in a group
+	@param group is the group
+	@return is a size_t corresponding to number of infected people in it
+	*/
+	const size_t get_infected(const size_t group) const;
+	/**
+	Getter for returning number of removed people in a group
+	@param group is the group
+	@return is a size_t corresponding to number of removed people in it
+	*/
+	const size_t get_removed(const size_t group) const;
+
+	/**
+	Getter for returning number of susceptible people over all groups
+	@return is a size_t corresponding to number of susceptible people
+	*/
+	const size_t get_total_susceptible() const;
+	/**
+	Getter for returning number of infected people over all groups
+	@return is a size_t corresponding to number of infected people
+	*/
+	const size_t get_total_infected() const;
+	/**
+	Getter for returning number of removed people over all groups
+	@return is a size_t corresponding to number of removed people
+	*/
+	const size_t get_total_removed() const;
+
+	/**
+	Getter for returning number of susceptible normal people (group 0)
 	@return is a size_t corresponding to number of susceptible normal people
 	*/
 	const size_t get_susceptible_normal() const;
 	/**
-	Getter for returning number of infected normal people
+	Getter for returning number of infected normal people (group 0)
 	@return is a size_t corresponding to number of infected normal people
 	*/
 	const size_t get_infected_normal() const;
 	/**
-	Getter for returning number of removed normal people
+	Getter for returning number of removed normal people (group 0)
 	@return is a size_t corresponding to number of removed normal people
 	*/
 	const size_t get_removed_normal() const;
 
 
 	/**
-	Getter for returning number of susceptible moron people
+	Getter for returning number of susceptible moron people (group 1)
 	@return is a size_t corresponding to number of susceptible moron people
 	*/
 	const size_t get_susceptible_moron() const;
 	/**
-	Getter for returning number of infected moron people
+	Getter for returning number of infected moron people (group 1)
 	@return is a size_t corresponding to number of infected moron people
 	*/
 	const size_t get_infected_moron() const;
 	/**
-	Getter for returning number of removed moron people
+	Getter for returning number of removed moron people (group 1)
 	@return is a size_t corresponding to number of removed moron people
 	*/
 	const size_t get_removed_moron() const;
 
 	/**
-	Sets initial size_ts as specified by the user
+	Sets initial size_ts as specified by the user, for the two default groups
 	@param num_normal is a const size_t corresponding to initial normal population
 	@param num_moron is a const size_t corresponding to initial moron population
 	@param num_sick is a const size_t corresponding to initial sick population
@@ -143,49 +965,195 @@ public:
 	void set_initial_populations(const size_t num_normal, const size_t num_moron, const size_t num_sick);
 
 	/**
-	@brief Creates person structs according to number specified by user and assigns 
-	them attributes, i.e. is_moron, network size (0 by default), and places them 
-	in their appropriate storage vectors
+	Sets the population of every group
+	@param sizes holds the number of people in each group, one entry per group of the
+	parameters
+	@param num_sick is a const size_t corresponding to initial sick population
+	*/
+	void set_group_populations(const std::vector<size_t>& sizes, const size_t num_sick);
+
+	/**
+	@brief Releases any population left from a previous run, then creates agents
+	according to number specified by user and assigns them attributes, i.e. their group
+	and an empty network, and places them in their appropriate storage vectors.
+	Agents are numbered group by group, starting with group 0. In tau_leap mode it sets
+	up contact_classes instead, and no agents
+	@throws std::length_error if the population does not fit in a 32 bit agent_id, or
+	in tau_leap mode if there are too many contact classes
+	@throws std::logic_error if the number of group sizes does not match the parameters,
+	or in tau_leap mode if the topology is not the configuration network
 	*/
 	void init_spread_network();
 
 	/**
 	@brief Generates network vectors for each person via random assignment through
-	configuration network method.
+	configuration network method, writing them straight into the CSR contact graph.
+
+	Stubs are shuffled and paired in O(edges), and the few pairs which would be a
+	self-loop or duplicate contact are rewired with a random accepted pair. Any other
+	parameters.topology is generated in parallel by generate_topology instead, and
+	tau_leap contact classes need no network at all
+	@throws std::length_error if a generated topology gives an agent more contacts
+	than the ill contact counters can hold
 	*/
 	void populate_spread_network();
 
 	/**
-	@brief Loops through susceptible people vector and randomly infects them based
-	on how many initial sick people were specified by the user
+	@brief Writes the generated network and every agent's group to a versioned
+	binary snapshot, see network_snapshot.h for the layout
+	@param path is the file to write
+	@throws std::runtime_error if the file cannot be written
+	@throws std::logic_error if the population is tau_leap contact classes
+	*/
+	void save_network(const std::string& path) const;
+
+	/**
+	@brief Maps a snapshot written by save_network and uses it in place of
+	init_spread_network and populate_spread_network. The population sizes come from
+	the file, initial_sick is still the one given to set_initial_populations.
+
+	Only the header and the section bounds are checked, the arrays are used as they are
+	mapped, so loading is O(population) for the groups and the per-agent counters while
+	the contacts are paged in as ticks first touch them. The file may be larger than
+	physical memory, tick_mode::synchronous then reads it front to back each day (see
+	set_graph_cache), while the other modes read contacts in infection order and are
+	only practical when it fits
+	@param path is the file to load
+	@throws std::runtime_error if the file cannot be mapped, is not a snapshot of a known
+	version and this byte order, or has another number of groups than the parameters
+	@throws std::logic_error in tau_leap mode, which has no agents to load
+	*/
+	void load_network(const std::string& path);
+
+	/**
+	@brief Uses the network and agent groups of another engine in place of
+	init_spread_network and populate_spread_network, for running replicates of one
+	population. The contact graph and agent groups are shared rather than copied, so
+	this engine only adds its own per-agent state. initial_sick is still the one given to set_initial_populations
+	@param source is an engine whose network has been generated or loaded, it may be
+	destroyed afterwards
+	In tau_leap mode there is no network, each engine draws its own contact classes
+	@throws std::logic_error if the groups differ, or only one engine is in tau_leap mode
+	*/
+	void share_network(const spread_engine& source);
+
+	/**
+	@brief Renumbers the agents so that contacts sit close together in memory, which
+	turns most of the counter updates of a tick from cache misses into hits on large
+	networks with local structure (a configuration network has none, any order of it is
+	as scattered as another). The network is rebuilt under the new ids in memory, so a
+	mapped snapshot is read once and no longer used.
+
+	Draws are keyed by agent id, so a reordered population is a different run of the
+	same epidemic, but saving it and loading it back gives exactly the same run again.
+	Call after the network is set up and before own_agents and randomly_infect_healthy
+	@param kind is the order, see contact_graph::ordering
+	@throws std::logic_error if anyone was infected already, the engine is partitioned
+	or the population is tau_leap contact classes
+	*/
+	void reorder_agents(const contact_graph::ordering kind);
+
+	/**
+	@brief Makes this engine simulate one partition of the population, for runs split
+	over several processes (see partitioned_run). The engine keeps a contiguous range of
+	agent ids and ghost copies of their contacts owned elsewhere, renumbered from 0, and
+	drops everyone else: the network, groups and health only cover them, and counters
+	and compartments only the owned agents. Changes of boundary agents reach the other partitions through halo each
+	synchronous tick, and since every agent's draws are keyed by their global id and
+	the day, the partitions together give exactly the results of one engine running the
+	whole population.
+
+	This engine holds the whole population until the call, load_partition sets up a
+	partition without ever doing so. Call after the network is set up and before
+	randomly_infect_healthy, with tick_mode::synchronous. The S, I and R getters then
+	count owned agents only, and interventions start over as with load_network
+	@param starts holds the first agent of every partition followed by the population
+	@param index is the partition this engine simulates
+	@param channel carries the halo updates, it must outlive the run
+	@throws std::logic_error if the mode is not synchronous or the partitions do not
+	cover the population in order
+	*/
+	void own_agents(const std::vector<std::uint32_t>& starts, const size_t index, halo_channel& channel);
+
+	/**
+	@brief Sets up one partition of a snapshot written by save_network, like
+	load_network followed by own_agents with the partitions of partition_by_contacts,
+	except that only the offsets and the partition's own contacts are read, and nothing
+	is kept per agent of the whole population but a bitmap while the partition is
+	built. Memory follows the partition's agents and ghosts, so a population too large
+	for one machine can be split over several
+	@param path is the file to load
+	@param parts is the number of partitions, at least 1
+	@param index is the partition this engine simulates
+	@param channel carries the halo updates, it must outlive the run
+	@throws std::runtime_error if the file cannot be mapped, is not a snapshot of a known
+	version and this byte order, or has another number of groups than the parameters
+	@throws std::logic_error if the mode is not synchronous or index is not a partition
+	*/
+	void load_partition(const std::string& path, const size_t parts, const size_t index, halo_channel& channel);
+
+	/**
+	Cuts the population into contiguous ranges holding about the same number of contacts
+	@param parts is the number of ranges, at least 1
+	@return is a std::vector<std::uint32_t> with the first agent of every range followed
+	by the population, as own_agents takes it
+	*/
+	std::vector<std::uint32_t> partition_by_contacts(const size_t parts) const;
+
+	/**
+	@brief Randomly infects as many susceptible people as initial sick people were
+	specified by the user, using O(initial_sick) random draws (one binomial per occupied
+	class in tau_leap mode)
 	*/
 	void randomly_infect_healthy();
 
 	/**
 	@brief Loops through network of person who just got sick or removed, and updates
 	each network stub accordingly
-	@param for_updating is the person whose network needs updating
+	@param for_updating is the agent whose network needs updating
 	@param is_sick specifies whether person just got sick or removed
 	*/
-	void update_people_contacts(person* for_updating, const bool is_sick);
+	void update_people_contacts(const agent_id for_updating, const bool is_sick);
 
 	/**
-	@brief Loops through susceptible people vector and randomly infects them based
-	on each person's risk factor as determined by their networks and statuses of contacts
+	@brief Loops through the frontier of at-risk susceptible people and randomly infects
+	them based on each person's risk factor as determined by their networks and statuses
+	of contacts, so a sweep costs O(frontier) rather than O(population)
 	*/
 	void infect_healthy_people();
 
 	/**
-	@brief Loops through infected people vector and randomly removes them based
-	on each person's recovery factor as determined by gamma, defined above
+	@brief Removes everyone the removal calendar holds for today, the removal days
+	themselves were drawn from gamma, set in the parameters, when each person got sick
 	*/
 	void remove_infected_people();
 	
 	/**
-	@brief caller function for interval calling of appropriate functions
+	@brief caller function for interval calling of appropriate functions,
+	advances the simulation by one day according to the tick_mode
+
+	In tick_mode::synchronous everyone's infection is decided against the ill contact
+	counts from the start of the day, then all new infections are scattered to their
+	contacts, then removals are decided and scattered the same way. Each random draw is
+	keyed by (seed, day, agent_id), so the stream a chunk uses only depends on the
+	agents in it and not on which thread runs it.
+
+	Interventions set for the day are applied before anything else
+	@throws std::logic_error if the population was set up for tau_leap and the mode is
+	another, or the other way round, or an intervention closes contacts in tau_leap mode
 	*/
 	void tick();
 
+	/**
+	@brief Advances the simulation until day days have elapsed. In the daily modes this
+	calls tick() until then, in tick_mode::next_reaction it fires every event before day,
+	stopping at the start of each intervention day to apply it
+	@param day is the day to stop at
+	@throws std::logic_error if the engine holds a partition and does not tick
+	synchronously
+	*/
+	void run_until(const size_t day);
+
 };
 
 #endif // ! SPREAD_ENGINE_H
\ No newline at end of file
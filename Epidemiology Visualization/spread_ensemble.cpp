@@ -0,0 +1,133 @@
+#include "spread_ensemble.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+// default constructor, seeds from std::random_device like spread_engine
+spread_ensemble::spread_ensemble() :
+	group_sizes{ 0, 0 }, num_sick(0),
+	base_seed((std::uint64_t(std::random_device{}()) << 32) | std::random_device{}()),
+	mode(spread_engine::tick_mode::immediate), levels{ 0.05, 0.5, 0.95 } {}
+
+void spread_ensemble::set_initial_populations(const size_t normal, const size_t moron, const size_t sick) {
+	set_group_populations({ normal, moron }, sick);
+}
+
+void spread_ensemble::set_group_populations(const std::vector<size_t>& sizes, const size_t sick) {
+	group_sizes = sizes;
+	num_sick = sick;
+}
+
+void spread_ensemble::set_seed(const std::uint64_t seed) { base_seed = seed; }
+void spread_ensemble::set_tick_mode(const spread_engine::tick_mode new_mode) { mode = new_mode; }
+void spread_ensemble::set_threads(const size_t threads) { workers.resize(threads > 0 ? threads : 1); }
+
+void spread_ensemble::set_quantiles(const std::vector<double>& new_levels) {
+	for (double level : new_levels) {
+		if (!(level >= 0.0 && level <= 1.0)) {
+			throw std::logic_error("Quantile levels must be between 0 and 1!");
+		}
+	}
+	levels = new_levels;
+}
+
+void spread_ensemble::set_parameters(const spread_parameters& new_parameters) { parameters = new_parameters; }
+void spread_ensemble::set_interventions(const std::vector<intervention>& timeline) { interventions = timeline; }
+
+void spread_ensemble::make_replicates(const size_t count) {
+	if (count == 0) {
+		throw std::logic_error("An ensemble needs at least one replicate!");
+	}
+
+	// every replicate gets its own seed from a splitmix64 sequence of the ensemble's seed,
+	// so two ensembles with the same seed draw common random numbers
+	std::uint64_t seed_state = base_seed;
+	replicates.clear();
+	replicates.resize(count);
+	for (std::unique_ptr<spread_engine>& engine : replicates) {
+		engine.reset(new spread_engine());
+		engine->set_seed(splitmix64(seed_state));
+		engine->set_tick_mode(mode);
+		engine->set_compact_compartments(true);
+		engine->set_parameters(parameters);
+		engine->set_interventions(interventions);
+		engine->set_group_populations(group_sizes, num_sick);
+	}
+}
+
+void spread_ensemble::build(const size_t count) {
+	make_replicates(count);
+
+	// replicate 0 generates the network, the rest share it
+	spread_engine& first = *replicates.front();
+	first.init_spread_network();
+	first.populate_spread_network();
+	attach(first);
+}
+
+void spread_ensemble::load(const std::string& path, const size_t count) {
+	make_replicates(count);
+
+	// replicate 0 maps the network, the rest share it
+	spread_engine& first = *replicates.front();
+	first.load_network(path);
+	attach(first);
+}
+
+void spread_ensemble::attach(const spread_engine& prototype, const size_t count) {
+	make_replicates(count);
+	attach(prototype);
+}
+
+void spread_ensemble::attach(const spread_engine& prototype) {
+	workers.run(replicates.size(), [&](const size_t index) {
+		if (replicates[index].get() != &prototype) { replicates[index]->share_network(prototype); }
+		replicates[index]->randomly_infect_healthy();
+	});
+}
+
+size_t spread_ensemble::size() const { return replicates.size(); }
+const spread_engine& spread_ensemble::replicate(const size_t index) const { return *replicates[index]; }
+
+spread_ensemble::compartment_summary spread_ensemble::summarize(const std::function<size_t(const spread_engine&)>& count) {
+	compartment_summary result;
+	result.mean = 0.0;
+
+	counts.clear();
+	for (const std::unique_ptr<spread_engine>& engine : replicates) {
+		counts.push_back(static_cast<double>(count(*engine)));
+		result.mean += counts.back();
+	}
+	if (counts.empty()) {
+		result.quantiles.assign(levels.size(), 0.0);
+		return result;
+	}
+	result.mean /= static_cast<double>(counts.size());
+
+	// quantiles interpolate linearly between the closest ranks
+	std::sort(counts.begin(), counts.end());
+	for (double level : levels) {
+		const double rank = level * static_cast<double>(counts.size() - 1);
+		const size_t below = static_cast<size_t>(std::floor(rank));
+		const size_t above = std::min(below + 1, counts.size() - 1);
+		result.quantiles.push_back(counts[below] + (rank - static_cast<double>(below)) * (counts[above] - counts[below]));
+	}
+	return result;
+}
+
+spread_ensemble::day_summary spread_ensemble::summary() {
+	day_summary today;
+	today.day = replicates.empty() ? 0 : replicates.front()->get_days_elapsed();
+	today.susceptible = summarize([](const spread_engine& e) { return e.get_total_susceptible(); });
+	today.infected = summarize([](const spread_engine& e) { return e.get_total_infected(); });
+	today.removed = summarize([](const spread_engine& e) { return e.get_total_removed(); });
+	return today;
+}
+
+void spread_ensemble::run(const size_t days, const std::function<void(const day_summary&)>& report) {
+	for (size_t day = 0; day < days; ++day) {
+		// replicates only share read-only data, so each one is an independent task
+		workers.run(replicates.size(), [&](const size_t index) { replicates[index]->tick(); });
+		report(summary());
+	}
+}
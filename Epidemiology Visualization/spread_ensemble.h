@@ -0,0 +1,213 @@
+#ifndef SPREAD_ENSEMBLE_H
+#define SPREAD_ENSEMBLE_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <functional>
+#include <cstdint>
+#include "spread_engine.h"
+#include "worker_pool.h"
+
+
+/**
+@class spread_ensemble
+@brief The spread_ensemble class runs many stochastic replicates of one scenario in
+lockstep and reports the spread of their S, I and R curves day by day.
+
+The contact network and agent groups are generated (or loaded) once and shared
+read-only by every replicate through spread_engine::share_network. Replicates keep no
+compartment lists (see spread_engine::set_compact_compartments), so each extra replicate
+only costs its ill contact counters, health and a frontier bit per agent, 5 bytes per
+agent with the two default groups, plus lists of the people at risk. Replicates
+tick in parallel, one task per replicate, and each one draws from its own seed, so the
+curves do not depend on the thread count.
+*/
+class spread_ensemble
+{
+public:
+
+	/**
+	@struct compartment_summary
+	@brief Mean and requested quantiles of one compartment's count across replicates
+	*/
+	struct compartment_summary {
+		double mean;
+		// one value per level passed to set_quantiles, in the same order
+		std::vector<double> quantiles;
+	};
+
+	/**
+	@struct day_summary
+	@brief Spread of every compartment, all groups combined, on one day
+	*/
+	struct day_summary {
+		size_t day;
+		compartment_summary susceptible;
+		compartment_summary infected;
+		compartment_summary removed;
+	};
+
+private:
+	// one engine per replicate, replicate 0 generates the network the rest share
+	std::vector<std::unique_ptr<spread_engine>> replicates;
+
+	// runs replicates' ticks in parallel
+	worker_pool workers;
+
+	// scenario shared by every replicate
+	std::vector<size_t> group_sizes;
+	size_t num_sick;
+	std::uint64_t base_seed;
+	spread_engine::tick_mode mode;
+
+	// rates and contact numbers every replicate uses
+	spread_parameters parameters;
+
+	// interventions every replicate applies
+	std::vector<intervention> interventions;
+
+	// quantile levels reported each day, in [0, 1]
+	std::vector<double> levels;
+
+	// one count per replicate, reused every day
+	std::vector<double> counts;
+
+	/**
+	Summarizes one compartment across replicates
+	@param count reads the compartment's count from a replicate
+	@return is a compartment_summary with the mean and every requested quantile
+	*/
+	compartment_summary summarize(const std::function<size_t(const spread_engine&)>& count);
+
+	/**
+	@brief Replaces the replicates with count fresh engines, seeded and configured but
+	without a network
+	@throws std::logic_error if count is 0
+	*/
+	void make_replicates(const size_t count);
+
+	/**
+	@brief Makes every replicate other than prototype share its network, then infects
+	each replicate's initial sick
+	@param prototype is an engine with a network, possibly one of the replicates
+	*/
+	void attach(const spread_engine& prototype);
+
+public:
+
+	// default constructor makes an empty ensemble with the 5%, 50% and 95% quantiles
+	// and a seed from std::random_device
+	spread_ensemble();
+
+	/**
+	Sets the scenario every replicate runs
+	@param normal is the number of normal people
+	@param moron is the number of morons
+	@param sick is the number of people infected on day 0
+	*/
+	void set_initial_populations(const size_t normal, const size_t moron, const size_t sick);
+
+	/**
+	Sets the scenario every replicate runs, with any number of groups
+	@param sizes holds the number of people in each group of the parameters
+	@param sick is the number of people infected on day 0
+	*/
+	void set_group_populations(const std::vector<size_t>& sizes, const size_t sick);
+
+	/**
+	Sets the seed the network and every replicate's seed are derived from
+	@param seed is the ensemble's seed, call before build or load
+	*/
+	void set_seed(const std::uint64_t seed);
+
+	/**
+	Sets how every replicate advances, see spread_engine::tick_mode
+	@param new_mode is the tick_mode, call before build or load
+	*/
+	void set_tick_mode(const spread_engine::tick_mode new_mode);
+
+	/**
+	Sets how many threads tick replicates, results do not depend on it
+	@param threads is the total number of threads including the caller
+	*/
+	void set_threads(const size_t threads);
+
+	/**
+	Sets the quantile levels reported each day
+	@param new_levels are levels in [0, 1], e.g. 0.5 for the median
+	@throws std::logic_error if a level is outside [0, 1]
+	*/
+	void set_quantiles(const std::vector<double>& new_levels);
+
+	/**
+	Sets the rates and contact numbers every replicate uses
+	@param new_parameters is the parameter set, call before build, load or attach
+	*/
+	void set_parameters(const spread_parameters& new_parameters);
+
+	/**
+	Sets the interventions every replicate applies, so ensembles attached to one
+	prototype can compare intervention timelines on the same network
+	@param timeline holds the interventions, see spread_engine::set_interventions, call
+	before build, load or attach
+	*/
+	void set_interventions(const std::vector<intervention>& timeline);
+
+	/**
+	@brief Generates the network once, then sets up count replicates sharing it and
+	infects each one's initial sick with its own seed
+	@param count is the number of replicates
+	@throws std::logic_error if count is 0
+	*/
+	void build(const size_t count);
+
+	/**
+	@brief Same as build, but maps the network from a snapshot written by
+	spread_engine::save_network rather than generating it
+	@param path is the snapshot file
+	@param count is the number of replicates
+	@throws std::logic_error if count is 0
+	*/
+	void load(const std::string& path, const size_t count);
+
+	/**
+	@brief Same as build, but shares the network of an engine built elsewhere, so
+	ensembles with different rates can run on one network
+	@param prototype is an engine whose network has been generated or loaded, its own
+	rates and infections are ignored and it may be destroyed afterwards
+	@param count is the number of replicates
+	@throws std::logic_error if count is 0
+	*/
+	void attach(const spread_engine& prototype, const size_t count);
+
+	/**
+	Getter for the number of replicates
+	@return is a size_t corresponding to the number of replicates built
+	*/
+	size_t size() const;
+
+	/**
+	Getter for one replicate
+	@param index is the replicate
+	@return is a const spread_engine& of that replicate
+	*/
+	const spread_engine& replicate(const size_t index) const;
+
+	/**
+	Summarizes the replicates as they are now
+	@return is a day_summary of the current day
+	*/
+	day_summary summary();
+
+	/**
+	@brief Advances every replicate by days days, one day at a time in lockstep, and
+	hands a summary of each day to report as soon as it is complete, so no curve is
+	kept in memory
+	@param days is the number of days to run
+	@param report is called once per day after every replicate has ticked
+	*/
+	void run(const size_t days, const std::function<void(const day_summary&)>& report);
+};
+
+#endif // ! SPREAD_ENSEMBLE_H
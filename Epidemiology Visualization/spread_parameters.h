@@ -0,0 +1,184 @@
+#ifndef SPREAD_PARAMETERS_H
+#define SPREAD_PARAMETERS_H
+
+#include <cstddef>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+
+
+/**
+@struct group_parameters
+@brief Network size and mask factor shared by every agent of one group
+*/
+struct group_parameters {
+	// number of contacts each agent of the group has
+	size_t contacts;
+	// factor on the hazard an ill agent of the group gives their contacts, the risk
+	// reduction of interacting with someone wearing a mask (1 without a mask)
+	double mask;
+};
+
+/**
+@struct network_topology
+@brief How populate_spread_network connects the agents. Every model but the
+configuration network ignores the groups' contact numbers and gives every group the
+same kind of network.
+
+configuration pairs up contact stubs at random, every agent gets exactly the contact
+number of their group.
+
+small_world is the Watts-Strogatz model: agents sit on a ring joined to the
+ring_neighbors nearest agents on each side, and each of those links has its far end
+moved to a random agent with probability rewiring.
+
+preferential_attachment is the Barabasi-Albert model: agents arrive in agent_id order
+and each joins attachments earlier agents picked in proportion to their contacts, which
+gives a few agents very large networks.
+
+households puts consecutive agents in households of household_size, all of whom are in
+contact, and everyone in one of a population / workplace_size random workplaces,
+where they meet the workplace_neighbors nearest coworkers on each side of a ring.
+*/
+struct network_topology {
+	enum class model { configuration, small_world, preferential_attachment, households };
+	model kind = model::configuration;
+
+	// small_world
+	size_t ring_neighbors = 5;
+	double rewiring = 0.1;
+
+	// preferential_attachment
+	size_t attachments = 5;
+
+	// households
+	size_t household_size = 4;
+	size_t workplace_size = 20;
+	size_t workplace_neighbors = 3;
+
+	/**
+	Checks whether two topologies generate the same networks
+	@param other is the topology to compare with
+	@return is true if the model and every parameter it reads are the same
+	*/
+	bool operator==(const network_topology& other) const {
+		if (kind != other.kind) { return false; }
+		switch (kind) {
+		case model::small_world: return ring_neighbors == other.ring_neighbors && rewiring == other.rewiring;
+		case model::preferential_attachment: return attachments == other.attachments;
+		case model::households: return household_size == other.household_size &&
+			workplace_size == other.workplace_size && workplace_neighbors == other.workplace_neighbors;
+		default: return true;
+		}
+	}
+
+	/**
+	Orders topologies so that those generating the same networks are adjacent, by model
+	and then by the parameters operator== compares
+	@param other is the topology to compare with
+	@return is true if this topology comes first
+	*/
+	bool operator<(const network_topology& other) const {
+		if (kind != other.kind) { return kind < other.kind; }
+		switch (kind) {
+		case model::small_world: return std::tie(ring_neighbors, rewiring) < std::tie(other.ring_neighbors, other.rewiring);
+		case model::preferential_attachment: return attachments < other.attachments;
+		case model::households: return std::tie(household_size, workplace_size, workplace_neighbors) <
+			std::tie(other.household_size, other.workplace_size, other.workplace_neighbors);
+		default: return false;
+		}
+	}
+};
+
+/**
+@struct spread_parameters
+@brief Epidemic and network parameters of a run, defaulting to the two groups the
+visualization was built around: normal people (group 0), who wear masks, and morons
+(group 1), who have more contacts and do not. The contact numbers are only read when a
+network is generated, everything else can change between any two ticks.
+
+A susceptible agent of group g gets sick at rate
+	eta = beta * sum over h of mixing(g, h) * groups[h].mask * (ill contacts of group h)
+*/
+struct spread_parameters {
+	// the hazard rate of getting COVID-19 per day when interacting with a sick person
+	double beta = 0.02;
+	// the daily rate people recover/die from the ill state and move into the removed group
+	double gamma = 1.0 / 14.0;
+
+	// normal people have 9 contacts and a mask (mu = 0.34), morons 20 and no mask
+	std::vector<group_parameters> groups{ { 9, 0.34 }, { 20, 1.0 } };
+
+	// group contact matrix, mixing[g * groups.size() + h] scales the hazard an ill
+	// contact of group h gives a susceptible agent of group g, empty means every entry is 1
+	std::vector<double> mixing;
+
+	// kind of network populate_spread_network generates, read with the contact numbers
+	network_topology topology;
+
+	/**
+	Entry of the group contact matrix
+	@param susceptible_group is the group of the agent at risk
+	@param ill_group is the group of their ill contact
+	@return is a double corresponding to mixing(susceptible_group, ill_group)
+	*/
+	double mixing_weight(const size_t susceptible_group, const size_t ill_group) const {
+		return mixing.empty() ? 1.0 : mixing[susceptible_group * groups.size() + ill_group];
+	}
+
+	/**
+	Checks whether two parameter sets generate networks the same way
+	@param other is the parameter set to compare with
+	@return is true if both have the same topology and groups with the same contact numbers
+	*/
+	bool same_network(const spread_parameters& other) const {
+		if (!(topology == other.topology) || groups.size() != other.groups.size()) { return false; }
+		for (size_t g = 0; g < groups.size(); ++g) {
+			if (groups[g].contacts != other.groups[g].contacts) { return false; }
+		}
+		return true;
+	}
+
+	/**
+	Orders parameter sets so that those which generate networks the same way are adjacent,
+	by topology and then by the groups' contact numbers
+	@param other is the parameter set to compare with
+	@return is true if this set comes first, and neither comes first exactly when
+	same_network holds
+	*/
+	bool network_before(const spread_parameters& other) const {
+		if (topology < other.topology) { return true; }
+		if (other.topology < topology) { return false; }
+		return std::lexicographical_compare(groups.begin(), groups.end(), other.groups.begin(), other.groups.end(),
+			[](const group_parameters& x, const group_parameters& y) { return x.contacts < y.contacts; });
+	}
+};
+
+/**
+@struct intervention
+@brief A change of contact behaviour from a given day on, such as a lockdown, a school
+closure or a mask mandate, applied to the network that already exists.
+
+contact_share closes contacts: of the contacts between people of groups g and h, only
+the share contact_share[g * groups + h] stay open. Which ones close is drawn once per
+contact from the run's seed, so a smaller share always closes a superset of the
+contacts a larger one closes, and going back to a share reopens exactly the same
+contacts. A share of 0 closes every contact between the two groups (isolating a group
+is a row and column of 0s) and 1 reopens them all. The matrix must be symmetric, as a
+contact is open for both people or neither.
+
+mask_scale multiplies each group's mask factor, on top of the parameters' masks.
+
+Either may be left empty to keep what the previous intervention set, a run starts
+with every contact open and every scale at 1.
+*/
+struct intervention {
+	// first day the change is in force, it is applied before that day's tick
+	size_t day = 0;
+	// share of contacts kept open between every pair of groups, row by row, or empty
+	std::vector<double> contact_share;
+	// factor on every group's mask, or empty
+	std::vector<double> mask_scale;
+};
+
+#endif // ! SPREAD_PARAMETERS_H
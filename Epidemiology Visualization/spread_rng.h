@@ -0,0 +1,232 @@
+#ifndef SPREAD_RNG_H
+#define SPREAD_RNG_H
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <array>
+
+
+/**
+@file spread_rng.h
+@brief Random number generators used by the simulator.
+
+xoshiro256ss is a small, fast sequential generator for the parts of a run that draw in
+a fixed order (network generation, initial infections, event delays). Its jump and
+long_jump functions split one seed into non-overlapping substreams for workers.
+
+philox_stream is a counter-based generator: each draw is a pure function of (seed, day,
+kind of draw, agent), so the daily sweeps can hand any agent to any thread, in any
+order, and still reproduce a run exactly. Its fill function generates the words for a
+whole batch of agents into a buffer that the sweeps then consume.
+
+Both are plain value types, so swapping in another generator with the same members only
+needs the aliases in spread_engine to change.
+*/
+
+
+/**
+Advances a splitmix64 state and returns its next output, used to expand one 64 bit
+seed into the larger states of the generators below
+@param state is the splitmix64 state, updated in place
+@return is a std::uint64_t corresponding to the next output
+*/
+inline std::uint64_t splitmix64(std::uint64_t& state) {
+	std::uint64_t x = (state += 0x9e3779b97f4a7c15ULL);
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+
+/**
+@class xoshiro256ss
+@brief xoshiro256** by Blackman and Vigna, a 256 bit state generator which satisfies the
+standard UniformRandomBitGenerator requirements, so it works with std::shuffle and the
+std distributions.
+*/
+class xoshiro256ss
+{
+public:
+	using result_type = std::uint64_t;
+
+private:
+	std::array<std::uint64_t, 4> state;
+
+	static std::uint64_t rotl(const std::uint64_t x, const int k) { return (x << k) | (x >> (64 - k)); }
+
+	// advances the state as if polynomial were applied, shared by jump and long_jump
+	void jump_by(const std::array<std::uint64_t, 4>& polynomial) {
+		std::array<std::uint64_t, 4> jumped{ 0, 0, 0, 0 };
+		for (std::uint64_t word : polynomial) {
+			for (int bit = 0; bit < 64; ++bit) {
+				if (word & (std::uint64_t(1) << bit)) {
+					for (size_t i = 0; i < 4; ++i) { jumped[i] ^= state[i]; }
+				}
+				(*this)();
+			}
+		}
+		state = jumped;
+	}
+
+public:
+
+	/**
+	Seeds the generator
+	@param seed is expanded into the 256 bit state with splitmix64
+	*/
+	explicit xoshiro256ss(std::uint64_t seed = 0) { this->seed(seed); }
+
+	/**
+	Reseeds the generator
+	@param seed is expanded into the 256 bit state with splitmix64
+	*/
+	void seed(std::uint64_t seed) {
+		for (std::uint64_t& word : state) { word = splitmix64(seed); }
+	}
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+	//returns the next 64 bit output
+	result_type operator()() {
+		const std::uint64_t result = rotl(state[1] * 5, 7) * 9;
+		const std::uint64_t t = state[1] << 17;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotl(state[3], 45);
+		return result;
+	}
+
+	/**
+	@brief Advances the generator by 2^128 outputs, so calling it k times on copies of
+	one generator gives k non-overlapping substreams
+	*/
+	void jump() {
+		jump_by({ 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL });
+	}
+
+	/**
+	@brief Advances the generator by 2^192 outputs, for splitting streams that are
+	themselves split with jump
+	*/
+	void long_jump() {
+		jump_by({ 0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL });
+	}
+
+	/**
+	Fills a buffer with raw 32 bit words, two per output
+	@param out is the buffer
+	@param count is the number of words wanted
+	*/
+	void fill(std::uint32_t* out, const size_t count) {
+		size_t i = 0;
+		for (; i + 1 < count; i += 2) {
+			const std::uint64_t word = (*this)();
+			out[i] = static_cast<std::uint32_t>(word >> 32);
+			out[i + 1] = static_cast<std::uint32_t>(word);
+		}
+		if (i < count) { out[i] = static_cast<std::uint32_t>((*this)() >> 32); }
+	}
+
+	/**
+	Makes substream index of a seed
+	@param seed is the seed shared by every substream
+	@param index picks the substream, it is the number of jumps from the seeded state
+	@return is a xoshiro256ss which does not overlap any other index of the same seed
+	*/
+	static xoshiro256ss substream(const std::uint64_t seed, const size_t index) {
+		xoshiro256ss generator(seed);
+		for (size_t i = 0; i < index; ++i) { generator.jump(); }
+		return generator;
+	}
+};
+
+
+/**
+@class philox_stream
+@brief Philox4x32-10 by Salmon et al., a counter-based generator. One stream covers one
+kind of draw on one day, and an agent's word is lane (agent % 4) of the block at
+counter (agent / 4, day, kind), keyed by the seed. Neighbouring agents share a block, so
+batches of sorted agents cost about one block per four words.
+*/
+class philox_stream
+{
+private:
+	std::uint32_t key0, key1;
+	std::uint32_t day_word, kind_word;
+
+	// 32 x 32 -> 64 bit multiply, split into its high and low halves
+	static void mulhilo(const std::uint32_t a, const std::uint32_t b, std::uint32_t& hi, std::uint32_t& lo) {
+		const std::uint64_t product = std::uint64_t(a) * b;
+		hi = static_cast<std::uint32_t>(product >> 32);
+		lo = static_cast<std::uint32_t>(product);
+	}
+
+public:
+
+	/**
+	Picks a stream
+	@param seed is the run's seed, used as the Philox key
+	@param day is the day the draws are for
+	@param kind separates different kinds of draws made on the same day
+	*/
+	philox_stream(const std::uint64_t seed, const std::uint64_t day, const std::uint32_t kind) :
+		key0(static_cast<std::uint32_t>(seed)), key1(static_cast<std::uint32_t>(seed >> 32)),
+		day_word(static_cast<std::uint32_t>(day)), kind_word(kind) {}
+
+	/**
+	Runs the 10 Philox rounds on one counter block
+	@param block is the block index
+	@return is the four 32 bit words of the block
+	*/
+	std::array<std::uint32_t, 4> block(const std::uint32_t block) const {
+		std::array<std::uint32_t, 4> c{ block, day_word, kind_word, 0 };
+		std::uint32_t k0 = key0, k1 = key1;
+		for (int round = 0; round < 10; ++round) {
+			std::uint32_t hi0, lo0, hi1, lo1;
+			mulhilo(0xD2511F53u, c[0], hi0, lo0);
+			mulhilo(0xCD9E8D57u, c[2], hi1, lo1);
+			c = { hi1 ^ c[1] ^ k0, lo1, hi0 ^ c[3] ^ k1, lo0 };
+			k0 += 0x9E3779B9u;
+			k1 += 0xBB67AE85u;
+		}
+		return c;
+	}
+
+	/**
+	Draws one agent's word
+	@param person is the agent
+	@return is a std::uint32_t corresponding to the agent's raw random word
+	*/
+	std::uint32_t word(const std::uint32_t person) const { return block(person >> 2)[person & 3]; }
+
+	/**
+	Draws the words of a batch of agents into a buffer, reusing each block for
+	consecutive agents that share it
+	@param people are the agents
+	@param count is the number of agents
+	@param out receives one word per agent
+	@param id_offset is added to every agent first, for agents numbered from another base
+	*/
+	void fill(const std::uint32_t* people, const size_t count, std::uint32_t* out, const std::uint32_t id_offset = 0) const {
+		std::array<std::uint32_t, 4> words{ 0, 0, 0, 0 };
+		std::uint32_t cached = 0;
+		bool have_block = false;
+		for (size_t i = 0; i < count; ++i) {
+			const std::uint32_t person = people[i] + id_offset;
+			const std::uint32_t wanted = person >> 2;
+			if (!have_block || wanted != cached) {
+				words = block(wanted);
+				cached = wanted;
+				have_block = true;
+			}
+			out[i] = words[person & 3];
+		}
+	}
+};
+
+#endif // ! SPREAD_RNG_H
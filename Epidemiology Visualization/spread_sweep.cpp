@@ -0,0 +1,120 @@
+#include "spread_sweep.h"
+#include <stdexcept>
+#include <algorithm>
+#include <memory>
+#include <numeric>
+
+// default constructor, seeds from std::random_device like spread_engine
+spread_sweep::spread_sweep() :
+	group_sizes{ 0, 0 }, num_sick(0),
+	base_seed((std::uint64_t(std::random_device{}()) << 32) | std::random_device{}()),
+	mode(spread_engine::tick_mode::immediate), replicates(1), batch_size(0), levels{ 0.05, 0.5, 0.95 } {}
+
+void spread_sweep::set_initial_populations(const size_t normal, const size_t moron, const size_t sick) {
+	set_group_populations({ normal, moron }, sick);
+}
+
+void spread_sweep::set_group_populations(const std::vector<size_t>& sizes, const size_t sick) {
+	group_sizes = sizes;
+	num_sick = sick;
+}
+
+void spread_sweep::set_seed(const std::uint64_t seed) { base_seed = seed; }
+void spread_sweep::set_tick_mode(const spread_engine::tick_mode new_mode) { mode = new_mode; }
+void spread_sweep::set_threads(const size_t threads) { workers.resize(threads > 0 ? threads : 1); }
+void spread_sweep::set_replicates(const size_t count) { replicates = count; }
+void spread_sweep::set_batch_size(const size_t points_per_batch) { batch_size = points_per_batch; }
+void spread_sweep::set_quantiles(const std::vector<double>& new_levels) { levels = new_levels; }
+
+size_t spread_sweep::add_point(const spread_parameters& point) {
+	points.push_back(point);
+	return points.size() - 1;
+}
+
+void spread_sweep::add_grid(const std::vector<double>& betas, const std::vector<double>& mus,
+	const std::vector<double>& gammas, const std::vector<size_t>& normal_contacts,
+	const std::vector<size_t>& moron_contacts) {
+	spread_parameters point;
+	for (double beta : betas) {
+		point.beta = beta;
+		for (double mu : mus) {
+			point.groups[0].mask = mu;
+			for (double gamma : gammas) {
+				point.gamma = gamma;
+				for (size_t normal : normal_contacts) {
+					point.groups[0].contacts = normal;
+					for (size_t moron : moron_contacts) {
+						point.groups[1].contacts = moron;
+						points.push_back(point);
+					}
+				}
+			}
+		}
+	}
+}
+
+size_t spread_sweep::size() const { return points.size(); }
+const spread_parameters& spread_sweep::point(const size_t index) const { return points[index]; }
+
+void spread_sweep::run(const size_t days, const std::function<void(size_t, const spread_ensemble::day_summary&)>& report) {
+	if (replicates == 0) {
+		throw std::logic_error("A sweep needs at least one replicate per point!");
+	}
+
+	// order points so that those sharing a topology and contact numbers, and so a
+	// network, are adjacent
+	std::vector<size_t> order(points.size());
+	std::iota(order.begin(), order.end(), size_t(0));
+	std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+		return points[a].network_before(points[b]);
+	});
+
+	const size_t batch = batch_size > 0 ? batch_size : workers.size();
+	std::vector<std::unique_ptr<spread_ensemble>> ensembles;
+	std::vector<std::vector<spread_ensemble::day_summary>> curves;
+
+	for (size_t group = 0; group < order.size(); ) {
+		// the group is every point generating the same network as its first one
+		size_t group_end = group + 1;
+		while (group_end < order.size() && points[order[group_end]].same_network(points[order[group]])) { ++group_end; }
+
+		// one network per group, generated from the sweep's seed, in the sweep's mode so
+		// tau_leap replicates find contact classes rather than a network to share
+		spread_engine prototype;
+		prototype.set_seed(base_seed);
+		prototype.set_tick_mode(mode);
+		prototype.set_parameters(points[order[group]]);
+		prototype.set_group_populations(group_sizes, num_sick);
+		prototype.init_spread_network();
+		prototype.populate_spread_network();
+
+		for (size_t first = group; first < group_end; first += batch) {
+			const size_t count = std::min(batch, group_end - first);
+			ensembles.resize(count);
+			curves.resize(count);
+
+			// each task sets up and runs one point's ensemble on its own, the prototype's
+			// network is only read
+			workers.run(count, [&](const size_t i) {
+				ensembles[i].reset(new spread_ensemble());
+				spread_ensemble& ensemble = *ensembles[i];
+				ensemble.set_seed(base_seed);
+				ensemble.set_tick_mode(mode);
+				ensemble.set_quantiles(levels);
+				ensemble.set_parameters(points[order[first + i]]);
+				ensemble.set_group_populations(group_sizes, num_sick);
+				ensemble.attach(prototype, replicates);
+
+				curves[i].clear();
+				ensemble.run(days, [&](const spread_ensemble::day_summary& today) { curves[i].push_back(today); });
+				// the replicates are done, hand their memory back before the next batch
+				ensembles[i].reset();
+			});
+
+			for (size_t i = 0; i < count; ++i) {
+				for (const spread_ensemble::day_summary& today : curves[i]) { report(order[first + i], today); }
+			}
+		}
+		group = group_end;
+	}
+}
@@ -0,0 +1,144 @@
+#ifndef SPREAD_SWEEP_H
+#define SPREAD_SWEEP_H
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include "spread_parameters.h"
+#include "spread_ensemble.h"
+#include "worker_pool.h"
+
+
+/**
+@class spread_sweep
+@brief The spread_sweep class runs an ensemble of replicates at every point of a list
+or grid of parameter sets, without rebuilding the program for each point.
+
+Points are grouped by their contact numbers, and each group generates a single network
+that all of its points share. Within a group, points run in batches, one ensemble per
+point and one worker task per ensemble. Every point's ensemble uses the sweep's seed,
+so replicate r sees the same network, initial infections and random words at every
+point (common random numbers), and differences between points come from the parameters
+rather than from noise.
+*/
+class spread_sweep
+{
+private:
+	// parameter sets to run, reported by their index in this list
+	std::vector<spread_parameters> points;
+
+	// scenario shared by every point
+	std::vector<size_t> group_sizes;
+	size_t num_sick;
+	std::uint64_t base_seed;
+	spread_engine::tick_mode mode;
+	size_t replicates;
+	// points run at the same time, 0 runs one per thread
+	size_t batch_size;
+	std::vector<double> levels;
+
+	// runs the ensembles of a batch in parallel
+	worker_pool workers;
+
+public:
+
+	// default constructor makes an empty sweep of 1 replicate per point, with a seed
+	// from std::random_device
+	spread_sweep();
+
+	/**
+	Sets the scenario every point runs
+	@param normal is the number of normal people
+	@param moron is the number of morons
+	@param sick is the number of people infected on day 0
+	*/
+	void set_initial_populations(const size_t normal, const size_t moron, const size_t sick);
+
+	/**
+	Sets the scenario every point runs, with any number of groups
+	@param sizes holds the number of people in each group of the parameters
+	@param sick is the number of people infected on day 0
+	*/
+	void set_group_populations(const std::vector<size_t>& sizes, const size_t sick);
+
+	/**
+	Sets the seed shared by every point
+	@param seed is the sweep's seed
+	*/
+	void set_seed(const std::uint64_t seed);
+
+	/**
+	Sets how every replicate advances, see spread_engine::tick_mode
+	@param new_mode is the tick_mode
+	*/
+	void set_tick_mode(const spread_engine::tick_mode new_mode);
+
+	/**
+	Sets how many threads run points, results do not depend on it
+	@param threads is the total number of threads including the caller
+	*/
+	void set_threads(const size_t threads);
+
+	/**
+	Sets the number of replicates run at each point
+	@param count is the number of replicates, at least 1
+	*/
+	void set_replicates(const size_t count);
+
+	/**
+	Sets how many points are held in memory and run at the same time
+	@param points_per_batch is the batch size, 0 runs one point per thread
+	*/
+	void set_batch_size(const size_t points_per_batch);
+
+	/**
+	Sets the quantile levels reported each day, see spread_ensemble::set_quantiles
+	@param new_levels are levels in [0, 1]
+	*/
+	void set_quantiles(const std::vector<double>& new_levels);
+
+	/**
+	Adds one parameter set
+	@param point is the parameter set
+	@return is a size_t corresponding to the index it is reported under
+	*/
+	size_t add_point(const spread_parameters& point);
+
+	/**
+	Adds every combination of the given values for the two default groups, the last
+	list varying fastest, with every other parameter at its default
+	@param betas are the values of beta
+	@param mus are the values of mu, the mask factor of normal people
+	@param gammas are the values of gamma
+	@param normal_contacts are the contact numbers of normal people
+	@param moron_contacts are the contact numbers of morons
+	*/
+	void add_grid(const std::vector<double>& betas, const std::vector<double>& mus,
+		const std::vector<double>& gammas, const std::vector<size_t>& normal_contacts,
+		const std::vector<size_t>& moron_contacts);
+
+	/**
+	Getter for the number of points
+	@return is a size_t corresponding to the number of points added
+	*/
+	size_t size() const;
+
+	/**
+	Getter for one point
+	@param index is the point's index
+	@return is a const spread_parameters& of that point
+	*/
+	const spread_parameters& point(const size_t index) const;
+
+	/**
+	@brief Runs every point for days days. After each batch, report is called for each
+	of its points' days in order, grouped by point; points sharing a network are run
+	together, so points are not necessarily reported in index order
+	@param days is the number of days to run
+	@param report is called with the point's index and one day's summary of its ensemble
+	@throws std::logic_error if there are no replicates
+	*/
+	void run(const size_t days, const std::function<void(size_t, const spread_ensemble::day_summary&)>& report);
+};
+
+#endif // ! SPREAD_SWEEP_H
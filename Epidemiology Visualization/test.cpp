@@ -0,0 +1,54 @@
+// checks for the simulator, built on its own with every .cpp file but main.cpp
+#include "spread_sweep.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// runs a small sweep in one tick mode and checks every point reports every day with
+// the whole population accounted for, returns the number of failures
+int check_sweep(const spread_engine::tick_mode mode, const std::string& name) {
+	const size_t normal = 9000, moron = 1000, sick = 20, days = 30;
+
+	spread_sweep sweep;
+	sweep.set_seed(7);
+	sweep.set_threads(2);
+	sweep.set_replicates(4);
+	sweep.set_tick_mode(mode);
+	sweep.set_initial_populations(normal, moron, sick);
+	sweep.add_grid({ 0.015, 0.025 }, { 0.34 }, { 1.0 / 14 }, { 9, 6 }, { 20 });
+
+	std::vector<size_t> reported(sweep.size(), 0);
+	int failures = 0;
+	try {
+		sweep.run(days, [&](const size_t point, const spread_ensemble::day_summary& today) {
+			++reported[point];
+			const double total = today.susceptible.mean + today.infected.mean + today.removed.mean;
+			if (total != static_cast<double>(normal + moron)) {
+				std::cout << name << ": point " << point << " day " << today.day << " counts " << total << " people\n";
+				++failures;
+			}
+		});
+	}
+	catch (const std::exception& error) {
+		std::cout << name << ": " << error.what() << '\n';
+		return failures + 1;
+	}
+
+	for (size_t point = 0; point < reported.size(); ++point) {
+		if (reported[point] != days) {
+			std::cout << name << ": point " << point << " reported " << reported[point] << " days\n";
+			++failures;
+		}
+	}
+	std::cout << name << (failures == 0 ? " sweep ok\n" : " sweep failed\n");
+	return failures;
+}
+
+int main() {
+	int failures = 0;
+	failures += check_sweep(spread_engine::tick_mode::immediate, "immediate");
+	failures += check_sweep(spread_engine::tick_mode::synchronous, "synchronous");
+	failures += check_sweep(spread_engine::tick_mode::next_reaction, "next_reaction");
+	failures += check_sweep(spread_engine::tick_mode::tau_leap, "tau_leap");
+	return failures == 0 ? 0 : 1;
+}
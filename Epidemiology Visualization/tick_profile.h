@@ -0,0 +1,196 @@
+#ifndef TICK_PROFILE_H
+#define TICK_PROFILE_H
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+#include "../Red Black Tree/Timer.h"
+
+
+/**
+@enum tick_phase
+@brief Parts of spread_engine::tick that tick_profile times.
+
+interventions applies the interventions due that day.
+
+hazard_sweep decides who gets sick: the chunked decisions of a synchronous tick, the
+whole frontier sweep of an immediate tick (whose transitions and counter updates happen
+inside it, one person at a time), drawing every pending event time when next_reaction
+starts, and the whole day of tau_leap contact classes.
+
+transitions moves the newly sick into infected and draws their removal days, in
+next_reaction every fired event with its contacts' rescheduling.
+
+counter_scatter brings the ill contact counters up to date, pushed or pulled, along with
+the halo exchange of a partitioned engine.
+
+compaction drops people from the frontier, including the leavers of a synchronous
+decision.
+
+removals collects the day's removals and moves them into removed.
+*/
+enum class tick_phase : size_t { interventions, hazard_sweep, transitions, counter_scatter, compaction, removals };
+
+/**
+@enum tick_counter
+@brief Work counted by tick_profile each day.
+
+agents_scanned is the number of people whose infection was decided (events fired in
+next_reaction, occupied classes in tau_leap), edges_touched the number of contact slots
+read to update counters, and rng_draws the number of random words or delays drawn
+(the binomials of tau_leap are not counted).
+*/
+enum class tick_counter : size_t { agents_scanned, edges_touched, rng_draws };
+
+/**
+@struct tick_record
+@brief One row of a tick_profile, the time and work of one tick
+*/
+struct tick_record {
+	// day the tick started on
+	size_t day;
+	// seconds spent in each tick_phase, by its value
+	std::array<double, 6> seconds;
+	// count of each tick_counter, by its value
+	std::array<std::uint64_t, 3> counts;
+};
+
+/**
+@class tick_profile
+@brief The tick_profile class records where the time of each spread_engine::tick goes,
+one tick_record per tick.
+
+It only records anything when the engine is built with SPREAD_PROFILE defined. Without it
+the SPREAD_PROFILE_ macros the engine marks its phases with expand to nothing, so a tick
+compiles to the same code as before they were added and the table stays empty.
+
+Phases are timed as laps: each mark adds the time since the previous mark to its phase,
+so the marks go at the end of each phase. Counters may be added to from worker threads.
+*/
+class tick_profile
+{
+public:
+	static constexpr size_t phase_count = 6;
+	static constexpr size_t counter_count = 3;
+
+#ifdef SPREAD_PROFILE
+	static constexpr bool enabled = true;
+#else
+	static constexpr bool enabled = false;
+#endif
+
+private:
+	// one row per finished tick
+	std::vector<tick_record> rows;
+	// the tick being recorded
+	tick_record current;
+	std::array<std::atomic<std::uint64_t>, counter_count> counts;
+	// started at the previous mark
+	simple_timer::timer<'s', double> clock;
+
+public:
+
+	// default constructor starts an empty table
+	tick_profile() : current{ 0, {}, {} } {
+		for (std::atomic<std::uint64_t>& count : counts) { count.store(0, std::memory_order_relaxed); }
+	}
+
+	/**
+	Starts recording a tick, anything counted since the last one is dropped
+	@param day is the day the tick starts on
+	*/
+	void begin_day(const size_t day) {
+		current = tick_record{ day, {}, {} };
+		for (std::atomic<std::uint64_t>& count : counts) { count.store(0, std::memory_order_relaxed); }
+		clock.tick();
+	}
+
+	/**
+	Finishes the tick begun last and adds its row to the table
+	*/
+	void end_day() {
+		for (size_t counter = 0; counter < counter_count; ++counter) {
+			current.counts[counter] = counts[counter].load(std::memory_order_relaxed);
+		}
+		rows.push_back(current);
+	}
+
+	/**
+	Ends a phase, adding the time since the previous mark (or the start of the tick) to it
+	@param phase is the phase that just ended
+	*/
+	void lap(const tick_phase phase) {
+		current.seconds[static_cast<size_t>(phase)] += clock.tock().count();
+		clock.tick();
+	}
+
+	/**
+	Adds to one of the current tick's counters, safe from any thread
+	@param counter is the counter
+	@param amount is added to it
+	*/
+	void add(const tick_counter counter, const std::uint64_t amount) {
+		counts[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	/**
+	Getter for the table
+	@return is a const std::vector<tick_record>& with one row per tick recorded
+	*/
+	const std::vector<tick_record>& records() const { return rows; }
+
+	/**
+	Empties the table
+	*/
+	void clear() { rows.clear(); }
+
+	/**
+	Writes the table as CSV, a header row and then one row per tick:
+		day,interventions_seconds,hazard_sweep_seconds,transitions_seconds,
+		counter_scatter_seconds,compaction_seconds,removals_seconds,
+		agents_scanned,edges_touched,rng_draws
+	@param out is the stream to write to
+	*/
+	void write_csv(std::ostream& out) const {
+		out << "day,interventions_seconds,hazard_sweep_seconds,transitions_seconds,"
+			"counter_scatter_seconds,compaction_seconds,removals_seconds,"
+			"agents_scanned,edges_touched,rng_draws\n";
+		for (const tick_record& row : rows) {
+			out << row.day;
+			for (double seconds : row.seconds) { out << ',' << seconds; }
+			for (std::uint64_t count : row.counts) { out << ',' << count; }
+			out << '\n';
+		}
+	}
+
+	/**
+	@class day_scope
+	@brief Records the tick of its lifetime, which ends the row on every way out of it
+	*/
+	class day_scope {
+	private:
+		tick_profile& profile;
+
+	public:
+		day_scope(tick_profile& _profile, const size_t day) : profile(_profile) { profile.begin_day(day); }
+		~day_scope() { profile.end_day(); }
+		day_scope(const day_scope&) = delete;
+		day_scope& operator=(const day_scope&) = delete;
+	};
+};
+
+// marks used by spread_engine, nothing is left of them without SPREAD_PROFILE
+#ifdef SPREAD_PROFILE
+#define SPREAD_PROFILE_DAY(profile, day) tick_profile::day_scope profiled_day((profile), (day))
+#define SPREAD_PROFILE_LAP(profile, phase) (profile).lap(tick_phase::phase)
+#define SPREAD_PROFILE_COUNT(profile, counter, amount) (profile).add(tick_counter::counter, (amount))
+#else
+#define SPREAD_PROFILE_DAY(profile, day) ((void)0)
+#define SPREAD_PROFILE_LAP(profile, phase) ((void)0)
+#define SPREAD_PROFILE_COUNT(profile, counter, amount) ((void)0)
+#endif
+
+#endif // ! TICK_PROFILE_H
@@ -0,0 +1,63 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+
+/**
+@class triple_buffer
+@brief Lock-free hand-off of the latest value of T from one writer thread to one reader
+thread.
+
+The writer fills its back slot and swaps it with the middle slot; the reader swaps the
+middle slot with its front slot whenever a new value was published. Neither side ever
+waits for the other, the reader always sees a complete value, and values the reader
+did not get to in time are simply skipped.
+
+@tparam T is the value type, it must be default constructible and copy assignable
+*/
+template<typename T>
+class triple_buffer
+{
+private:
+	// flag set in middle when it holds a value the reader has not taken yet
+	static constexpr std::uint8_t fresh = 4;
+
+	T slots[3];
+	// index of the middle slot, together with the fresh flag
+	std::atomic<std::uint8_t> middle;
+	// slots owned by the writer and the reader
+	std::uint8_t back;
+	std::uint8_t front;
+
+public:
+
+	// default constructor, every slot holds a default constructed T
+	triple_buffer() : middle(1), back(0), front(2) {}
+
+	triple_buffer(const triple_buffer&) = delete;
+	triple_buffer& operator=(const triple_buffer&) = delete;
+
+	/**
+	Publishes a value, writer thread only
+	@param value is copied into the back slot, which then becomes the middle slot
+	*/
+	void publish(const T& value) {
+		slots[back] = value;
+		back = middle.exchange(static_cast<std::uint8_t>(back | fresh), std::memory_order_acq_rel) & 3;
+	}
+
+	/**
+	Gets the latest published value, reader thread only
+	@return is a const T& to the newest value, valid until the next call to read
+	*/
+	const T& read() {
+		if (middle.load(std::memory_order_relaxed) & fresh) {
+			front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+		}
+		return slots[front];
+	}
+};
+
+#endif // ! TRIPLE_BUFFER_H
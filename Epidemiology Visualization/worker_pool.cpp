@@ -0,0 +1,102 @@
+#include "worker_pool.h"
+
+worker_pool::worker_pool(const size_t threads) :
+	job(nullptr), job_tasks(0), next_task(0), busy_workers(0), generation(0), stopping(false) {
+	resize(threads);
+}
+
+worker_pool::~worker_pool() { stop(); }
+
+void worker_pool::stop() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+	stopping = false;
+}
+
+void worker_pool::resize(const size_t threads) {
+	stop();
+	// new workers start from the current job, which they never joined, so a pool that
+	// has run jobs already does not wake them straight away
+	size_t started_generation = 0;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		started_generation = generation;
+	}
+	// the calling thread counts as one of the threads
+	for (size_t i = 1; i < threads; ++i) {
+		workers.emplace_back(&worker_pool::work, this, started_generation);
+	}
+}
+
+size_t worker_pool::size() const { return workers.size() + 1; }
+
+void worker_pool::drain() {
+	// grab task indices until the job runs out
+	for (size_t i = next_task++; i < job_tasks; i = next_task++) {
+		try {
+			(*job)(i);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> guard(lock);
+			if (!failure) { failure = std::current_exception(); }
+		}
+	}
+}
+
+void worker_pool::work(size_t seen_generation) {
+	while (true) {
+		{
+			// sleep until a new job is posted or the pool stops
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [&] { return stopping || generation != seen_generation; });
+			if (stopping) { return; }
+			seen_generation = generation;
+		}
+
+		drain();
+
+		{
+			// last worker out wakes the caller of run
+			std::lock_guard<std::mutex> guard(lock);
+			if (--busy_workers == 0) { done.notify_one(); }
+		}
+	}
+}
+
+void worker_pool::run(const size_t tasks, const std::function<void(size_t)>& task) {
+	// nothing to share, so skip the hand-off entirely
+	if (workers.empty() || tasks <= 1) {
+		for (size_t i = 0; i < tasks; ++i) {
+			task(i);
+		}
+		return;
+	}
+
+	{
+		// post the job
+		std::lock_guard<std::mutex> guard(lock);
+		job = &task;
+		job_tasks = tasks;
+		next_task = 0;
+		busy_workers = workers.size();
+		failure = nullptr;
+		++generation;
+	}
+	wake.notify_all();
+
+	// calling thread works too
+	drain();
+
+	// wait for every worker to finish its last task
+	std::unique_lock<std::mutex> guard(lock);
+	done.wait(guard, [&] { return busy_workers == 0; });
+	job = nullptr;
+	if (failure) { std::rethrow_exception(failure); }
+}
@@ -0,0 +1,93 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+
+
+/**
+@class worker_pool
+@brief The worker_pool class keeps a fixed set of threads alive between calls so that
+each tick of the simulation can be split into tasks without paying for thread creation.
+
+A call to run hands out task indices 0 to tasks - 1 to the workers and the calling
+thread, and returns once every task has finished. Which thread runs a task is not
+fixed, so tasks must not depend on it.
+*/
+class worker_pool
+{
+private:
+	// threads other than the caller of run
+	std::vector<std::thread> workers;
+
+	// guards everything below except next_task
+	std::mutex lock;
+	// signalled when a new job is posted or the pool is stopping
+	std::condition_variable wake;
+	// signalled when the last busy worker finishes a job
+	std::condition_variable done;
+
+	// job currently being run and how many tasks it has
+	const std::function<void(size_t)>* job;
+	size_t job_tasks;
+	// next task index to be handed out
+	std::atomic<size_t> next_task;
+	// number of workers still running the current job
+	size_t busy_workers;
+	// incremented for every job so sleeping workers can tell a new one was posted
+	size_t generation;
+	// set by the destructor to end every worker
+	bool stopping;
+	// first exception thrown by a task, rethrown by run
+	std::exception_ptr failure;
+
+	// loop run by each worker thread, which sleeps until a job after seen_generation is posted
+	void work(size_t seen_generation);
+
+	// hands out tasks of the current job until there are none left
+	void drain();
+
+	// stops and joins every worker
+	void stop();
+
+public:
+
+	/**
+	Starts the pool
+	@param threads is the total number of threads to run tasks on, including the
+	thread calling run, so 1 (the default) runs everything on the caller
+	*/
+	explicit worker_pool(const size_t threads = 1);
+
+	// stops and joins every worker
+	~worker_pool();
+
+	worker_pool(const worker_pool&) = delete;
+	worker_pool& operator=(const worker_pool&) = delete;
+
+	/**
+	Changes the number of threads in the pool
+	@param threads is the total number of threads to run tasks on, including the caller
+	*/
+	void resize(const size_t threads);
+
+	/**
+	Getter for the number of threads tasks run on
+	@return is a size_t corresponding to the workers plus the calling thread
+	*/
+	size_t size() const;
+
+	/**
+	Runs task(i) for every i from 0 to tasks - 1 and waits for all of them
+	@param tasks is the number of tasks
+	@param task is called once with each task index
+	*/
+	void run(const size_t tasks, const std::function<void(size_t)>& task);
+};
+
+#endif // ! WORKER_POOL_H
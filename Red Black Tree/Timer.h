@@ -106,6 +106,12 @@ namespace simple_timer {
 				*/
 				interval(const precision& _len) : len(_len) {}
 
+				/**
+				This function gives the length of time as a number, for adding up intervals
+				@return the length of time in the timer's unit
+				*/
+				precision count() const { return len; }
+
 				/**
 				This allows for the intervals to be printed
 				@param o an ostream